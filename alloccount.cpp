@@ -0,0 +1,114 @@
+#include "alloccount.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+// Replaceable global operator new/delete that count every C++ heap allocation of the
+// process, Skia's included, per thread before handing it to malloc.
+
+namespace perf::alloc
+{
+    constinit thread_local AllocCounters threadCounters;
+}
+
+namespace
+{
+    // failed attempts are not counted, the new_handler loop below may retry them
+    void* counted(void* ptr, std::size_t size) {
+        if (ptr) {
+            perf::alloc::threadCounters.allocations++;
+            perf::alloc::threadCounters.bytes += size;
+        }
+        return ptr;
+    }
+
+    void* allocate(std::size_t size) {
+        return counted(std::malloc(size ? size : 1), size);
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+        // aligned_alloc wants a size that is a multiple of the alignment
+        std::size_t align = static_cast<std::size_t>(alignment);
+        return counted(std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align), size);
+    }
+
+    void release(void* ptr) {
+        if (ptr) {
+            perf::alloc::threadCounters.frees++;
+            std::free(ptr);
+        }
+    }
+}
+
+// like the library's own: on failure call the new_handler, which may free memory, and retry
+void* operator new(std::size_t size) {
+    void* ptr;
+    while (!(ptr = allocate(size))) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+// the nothrow forms go through the new_handler too and return null where those throw
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    void* ptr;
+    while (!(ptr = allocateAligned(size, alignment))) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size, alignment);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return operator new(size, alignment, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept { release(ptr); }
+void operator delete[](void* ptr) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { release(ptr); }
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace perf
+{
+    // Heap use of one thread as counted by the global operator new/delete replacements
+    // in alloccount.cpp, which a target has to link for these to be defined. Only C++
+    // allocations go through them; malloc() calls (e.g. Skia's sk_malloc) do not.
+    struct AllocCounters
+    {
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+        uint64_t bytes = 0; // requested by the allocations
+    };
+
+    inline AllocCounters operator-(const AllocCounters& a, const AllocCounters& b) {
+        return {a.allocations - b.allocations, a.frees - b.frees, a.bytes - b.bytes};
+    }
+
+    inline AllocCounters operator+(const AllocCounters& a, const AllocCounters& b) {
+        return {a.allocations + b.allocations, a.frees + b.frees, a.bytes + b.bytes};
+    }
+
+    namespace alloc
+    {
+        // per thread, so counting needs no atomics; constinit keeps access free of init checks
+        extern constinit thread_local AllocCounters threadCounters;
+    }
+
+    // the calling thread's totals since it started; subtract two reads to measure a piece of code
+    inline AllocCounters threadAllocCounters() {
+        return alloc::threadCounters;
+    }
+}
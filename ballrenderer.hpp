@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "include/core/SkCanvas.h"
+#include "include/core/SkColor.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkImageInfo.h"
+#include "include/core/SkPaint.h"
+#include "include/core/SkRSXform.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkSamplingOptions.h"
+#include "include/core/SkSurface.h"
+#include "include/gpu/graphite/Image.h"
+#include "include/gpu/graphite/Recorder.h"
+#include "physics.hpp"
+
+namespace sim
+{
+    // Draws all balls as one drawAtlas batch instead of one drawCircle per ball.
+    // A white anti-aliased circle is rasterized once into a sprite; every ball is an
+    // RSXform placing that sprite plus a per-instance colour, which kModulate blends
+    // into the sprite. The per-frame work is filling two flat arrays, and the
+    // recorder sees a single draw no matter how many balls there are.
+    class BallRenderer
+    {
+        public:
+            // (Re)builds the sprite for circles of radius pixels. With a Graphite recorder
+            // the sprite is uploaded once as a texture, without one it stays a raster image.
+            bool prepare(float radius, skgpu::graphite::Recorder* recorder) {
+                int size = (int)std::ceil(radius) * 2 + 2; // one pixel of AA fringe per side
+                sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(size, size));
+                if (!surface) {
+                    return false;
+                }
+                SkPaint paint;
+                paint.setAntiAlias(true);
+                paint.setColor(SK_ColorWHITE);
+                surface->getCanvas()->clear(SK_ColorTRANSPARENT);
+                surface->getCanvas()->drawCircle(size * 0.5f, size * 0.5f, radius, paint);
+
+                mRasterSprite = surface->makeImageSnapshot();
+                mSprite = recorder ? SkImages::TextureFromImage(recorder, mRasterSprite.get()) : mRasterSprite;
+                mHalfSize = size * 0.5f;
+                std::fill(mTexRects.begin(), mTexRects.end(), SkRect::MakeWH(size, size));
+                return mSprite != nullptr;
+            }
+
+            // draws snap interpolated by alpha; toPixel maps meters to pixels
+            template<typename ToPixel>
+            void draw(SkCanvas* canvas, const BallSnapshot& snap, float alpha, ToPixel toPixel) {
+                size_t count = snap.size();
+                if (count == 0 || !mSprite) {
+                    return;
+                }
+                if (mXforms.size() != count) {
+                    mXforms.resize(count);
+                    mColors.resize(count);
+                    mTexRects.resize(count, SkRect::MakeWH(mHalfSize * 2.0f, mHalfSize * 2.0f));
+                }
+
+                for (size_t c = 0; c < count; ++c) {
+                    float x = snap.prevX[c] + (snap.posX[c] - snap.prevX[c]) * alpha;
+                    float y = snap.prevY[c] + (snap.posY[c] - snap.prevY[c]) * alpha;
+                    mXforms[c] = SkRSXform::Make(1.0f, 0.0f, toPixel(x) - mHalfSize, toPixel(y) - mHalfSize);
+
+                    // same colour ramp as the per-circle path
+                    float scaledVelocity = std::clamp(std::abs(snap.velY[c] / 15.0f), 0.0f, 1.0f);
+                    mColors[c] = SkColor4f{scaledVelocity, 0.0f, 0.35f, 1.0f}.toSkColor();
+                }
+
+                canvas->drawAtlas(mSprite.get(), mXforms.data(), mTexRects.data(), mColors.data(), (int)count,
+                                  SkBlendMode::kModulate, SkSamplingOptions(SkFilterMode::kLinear), nullptr, nullptr);
+            }
+
+            // the raster original of a texture sprite, for serializing pictures that draw it
+            bool isSprite(const SkImage* image) const { return image == mSprite.get(); }
+            const sk_sp<SkImage>& getRasterSprite() const { return mRasterSprite; }
+
+        private:
+            sk_sp<SkImage> mSprite;
+            sk_sp<SkImage> mRasterSprite;
+            float mHalfSize = 0.0f;
+            std::vector<SkRSXform> mXforms;
+            std::vector<SkRect> mTexRects;
+            std::vector<SkColor> mColors;
+    };
+}
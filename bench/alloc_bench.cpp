@@ -0,0 +1,188 @@
+#include "../alloccount.hpp"
+#include "../physics.hpp"
+#include "../collision.hpp"
+#include "../threadpool.hpp"
+#include "../pipeline.hpp"
+#include "../scheduler.hpp"
+#include "../sharedperfbuffer.hpp"
+#include "../metricsshm.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+// Checks that the app's own per-frame code does not allocate once it runs, the claim
+// the app's allocation report rests on. Linked with alloccount.cpp like the app; every
+// part runs warm-up iterations first (buffers grow, first calls set up), then counts
+// the heap allocations of the measured ones on every thread that takes part:
+//   physics   sim::step on the physics pool plus BallCollider::resolve
+//   pipeline  items passed through an OrderedPipeline (workers and consumer)
+//   frame     FrameScheduler, SharedPerfBuffer::addSample and MetricsWriter::publish
+// Exits non-zero when any of them allocates.
+//
+// usage: alloc_bench [iterations]
+
+struct Part
+{
+    const char* name;
+    uint64_t iterations;
+    perf::AllocCounters allocs;
+};
+
+// the physics thread's tick, with enough balls for the pool to split the step
+static Part physicsPart(uint64_t warmup, uint64_t iterations) {
+    const size_t count = 20000;
+    const size_t chunkSize = 4096; // PHYSICS_CHUNK_SIZE in the app
+    const double dt = 1.0 / 240.0;
+    sim::WorldParams world;
+    world.radius = 0.01;
+    sim::BallStore balls;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> x(world.left + world.radius, world.right - world.radius);
+    std::uniform_real_distribution<double> y(world.top + world.radius, world.floor - world.radius);
+    std::uniform_real_distribution<double> v(-3.0, 3.0);
+    balls.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        balls.posX[i] = x(rng);
+        balls.posY[i] = y(rng);
+        balls.velX[i] = v(rng);
+        balls.velY[i] = v(rng);
+    }
+    std::vector<double> prevX(count), prevY(count);
+    sim::WorkStealingPool pool(2);
+    sim::BallCollider collider;
+
+    // the pool's other thread is counted inside the chunks it runs
+    std::atomic<uint64_t> chunkAllocs{0}, chunkBytes{0};
+    std::atomic<bool> counting{false};
+    auto tick = [&]() {
+        pool.parallelFor(0, count, chunkSize, [&](size_t begin, size_t end) {
+            perf::AllocCounters start = perf::threadAllocCounters();
+            std::copy(balls.posX.begin() + begin, balls.posX.begin() + end, prevX.begin() + begin);
+            std::copy(balls.posY.begin() + begin, balls.posY.begin() + end, prevY.begin() + begin);
+            sim::step(balls, world, dt, begin, end);
+            perf::AllocCounters used = perf::threadAllocCounters() - start;
+            if (counting.load(std::memory_order_relaxed)) {
+                chunkAllocs.fetch_add(used.allocations, std::memory_order_relaxed);
+                chunkBytes.fetch_add(used.bytes, std::memory_order_relaxed);
+            }
+        });
+        collider.resolve(balls, world, dt);
+    };
+
+    for (uint64_t i = 0; i < warmup; ++i) {
+        tick();
+    }
+    counting = true;
+    perf::AllocCounters start = perf::threadAllocCounters();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        tick();
+    }
+    perf::AllocCounters used = perf::threadAllocCounters() - start;
+    used.allocations += chunkAllocs;
+    used.bytes += chunkBytes;
+    return {"physics", iterations, used};
+}
+
+// each item carries its worker's running totals as of make(), so the difference
+// between two items of the same worker is what the worker allocated in between
+struct PipelineItem
+{
+    uint64_t frame = 0;
+    perf::AllocCounters workerAllocs;
+};
+
+static Part pipelinePart(uint64_t warmup, uint64_t iterations) {
+    const size_t workers = 2;
+    const size_t depth = 1; // RECORD_QUEUE_DEPTH in the app
+    std::atomic<uint64_t> latched{0};
+    sim::OrderedPipeline<PipelineItem> pipeline(workers, depth, [&](size_t, uint64_t frame) {
+        latched.store(frame, std::memory_order_relaxed);
+    }, [](size_t, uint64_t frame) {
+        return PipelineItem{frame, perf::threadAllocCounters()};
+    });
+
+    PipelineItem item;
+    std::vector<perf::AllocCounters> first(workers);
+    for (uint64_t f = 0; f < warmup + workers; ++f) {
+        pipeline.next(item);
+        if (f >= warmup) {
+            first[f % workers] = item.workerAllocs;
+        }
+    }
+    std::vector<perf::AllocCounters> last = first;
+    perf::AllocCounters start = perf::threadAllocCounters();
+    for (uint64_t f = warmup + workers; f < warmup + workers + iterations; ++f) {
+        if (!pipeline.next(item) || item.frame != f) {
+            fprintf(stderr, "pipeline handed out frame %llu as %llu\n", (unsigned long long)item.frame, (unsigned long long)f);
+            exit(1);
+        }
+        last[f % workers] = item.workerAllocs;
+    }
+    perf::AllocCounters used = perf::threadAllocCounters() - start;
+    for (size_t w = 0; w < workers; ++w) {
+        used = used + (last[w] - first[w]);
+    }
+    return {"pipeline", iterations, used};
+}
+
+// the render thread's bookkeeping around a frame: pacing, the perf series and the metrics segment
+static Part framePart(uint64_t warmup, uint64_t iterations) {
+    perf::SharedPerfBuffer drawTimes(512), physicsTimes(512), latency(512);
+    perf::MetricsWriter metrics;
+    metrics.addSeries("draw", "us", &drawTimes);
+    metrics.addSeries("physics", "ns", &physicsTimes);
+    metrics.addSeries("latency", "us", &latency);
+    std::string name = "/alloc-bench-" + std::to_string(getpid());
+    if (!metrics.open(name.c_str())) {
+        exit(1);
+    }
+    sim::FrameScheduler scheduler(sim::FrameScheduler::FIXED, 20000.0);
+    std::atomic<bool> run{true};
+
+    auto frame = [&](uint64_t i) {
+        scheduler.waitForFrame(run, []() { return true; });
+        drawTimes.addSample((uint32_t)(i * 7919 % 20000));
+        physicsTimes.addSample((uint32_t)(i * 104729 % 200000));
+        latency.addSample((uint32_t)(i * 31 % 12000));
+        sim::FrameScheduler::Stats pacing = scheduler.getStats();
+        perf::MetricsCounters counters;
+        counters.frames = pacing.frames;
+        counters.presented = pacing.frames;
+        counters.missed = pacing.missed;
+        counters.skipped = pacing.skipped;
+        metrics.publish(counters);
+    };
+
+    for (uint64_t i = 0; i < warmup; ++i) {
+        frame(i);
+    }
+    perf::AllocCounters start = perf::threadAllocCounters();
+    for (uint64_t i = warmup; i < warmup + iterations; ++i) {
+        frame(i);
+    }
+    return {"frame", iterations, perf::threadAllocCounters() - start};
+}
+
+int main(int argc, char** argv) {
+    uint64_t iterations = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000;
+    const uint64_t warmup = 100;
+
+    const Part parts[] = {physicsPart(warmup, iterations), pipelinePart(warmup, iterations), framePart(warmup, iterations)};
+
+    bool clean = true;
+    printf("%-10s %12s %12s %12s\n", "part", "iterations", "allocations", "bytes");
+    for (const Part& part : parts) {
+        printf("%-10s %12llu %12llu %12llu\n", part.name, (unsigned long long)part.iterations,
+               (unsigned long long)part.allocs.allocations, (unsigned long long)part.allocs.bytes);
+        clean = clean && part.allocs.allocations == 0;
+    }
+
+    if (!clean) {
+        fprintf(stderr, "the frame path allocates after warm-up\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark harness.
+// Each case is a function that runs its operation 'iterations' times. The harness
+// calibrates the iteration count so one repetition takes at least minRepSeconds,
+// runs warmup repetitions, then reports ns per operation over the measured ones
+// (median, p10, p90, min, max) as a table and optionally as JSON.
+// All of a call is timed, so cases prepare their inputs before they are added.
+namespace bench
+{
+    // keeps a value alive so the measured work is not optimized away
+    template<typename T>
+    inline void doNotOptimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct Options
+    {
+        int warmup = 3;
+        int repetitions = 15;
+        double minRepSeconds = 0.01;
+        const char* filter = nullptr;
+        const char* jsonPath = nullptr;
+    };
+
+    struct Result
+    {
+        std::string name;
+        uint64_t iterations = 0; // per repetition
+        double median = 0.0;     // ns per operation
+        double p10 = 0.0;
+        double p90 = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+    };
+
+    class Runner
+    {
+        public:
+            using Fn = std::function<void(uint64_t iterations)>;
+
+            void add(std::string name, Fn fn) {
+                mCases.push_back({std::move(name), std::move(fn)});
+            }
+
+            int run(const Options& options) {
+                printf("%-40s %12s %12s %12s %12s %12s\n", "benchmark", "median ns", "p10 ns", "p90 ns", "min ns", "max ns");
+                for (const auto& c : mCases) {
+                    if (options.filter && c.name.find(options.filter) == std::string::npos) {
+                        continue;
+                    }
+                    Result r = measure(c, options);
+                    printf("%-40s %12.2f %12.2f %12.2f %12.2f %12.2f\n", r.name.c_str(), r.median, r.p10, r.p90, r.min, r.max);
+                    fflush(stdout);
+                    mResults.push_back(r);
+                }
+                if (options.jsonPath) {
+                    return writeJson(options.jsonPath) ? 0 : 1;
+                }
+                return 0;
+            }
+
+        private:
+            struct Case
+            {
+                std::string name;
+                Fn fn;
+            };
+
+            static double seconds(const Case& c, uint64_t iterations) {
+                auto start = std::chrono::steady_clock::now();
+                c.fn(iterations);
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            static Result measure(const Case& c, const Options& options) {
+                uint64_t iterations = 1;
+                while (seconds(c, iterations) < options.minRepSeconds && iterations < (1ull << 40)) {
+                    iterations *= 2;
+                }
+                for (int i = 0; i < options.warmup; ++i) {
+                    seconds(c, iterations);
+                }
+
+                std::vector<double> ns(std::max(options.repetitions, 1));
+                for (auto& v : ns) {
+                    v = seconds(c, iterations) * 1e9 / iterations;
+                }
+                std::sort(ns.begin(), ns.end());
+                auto pct = [&](double p) { return ns[(size_t)std::lround(p / 100.0 * (ns.size() - 1))]; };
+
+                Result r;
+                r.name = c.name;
+                r.iterations = iterations;
+                r.median = pct(50.0);
+                r.p10 = pct(10.0);
+                r.p90 = pct(90.0);
+                r.min = ns.front();
+                r.max = ns.back();
+                return r;
+            }
+
+            bool writeJson(const char* path) const {
+                FILE* f = fopen(path, "w");
+                if (!f) {
+                    fprintf(stderr, "Failed to open %s\n", path);
+                    return false;
+                }
+                fprintf(f, "{\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [\n");
+                for (size_t i = 0; i < mResults.size(); ++i) {
+                    const Result& r = mResults[i];
+                    fprintf(f, "    {\"name\": \"%s\", \"iterations\": %llu, \"median\": %.3f, \"p10\": %.3f, \"p90\": %.3f, \"min\": %.3f, \"max\": %.3f}%s\n",
+                            r.name.c_str(), (unsigned long long)r.iterations, r.median, r.p10, r.p90, r.min, r.max,
+                            i + 1 < mResults.size() ? "," : "");
+                }
+                fprintf(f, "  ]\n}\n");
+                fclose(f);
+                return true;
+            }
+
+            std::vector<Case> mCases;
+            std::vector<Result> mResults;
+    };
+
+    // --warmup N --reps N --min-time SECONDS --filter SUBSTRING --json FILE
+    inline Options parseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+                options.warmup = atoi(argv[++i]);
+            }
+            else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+                options.repetitions = atoi(argv[++i]);
+            }
+            else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+                options.minRepSeconds = atof(argv[++i]);
+            }
+            else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+                options.filter = argv[++i];
+            }
+            else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+                options.jsonPath = argv[++i];
+            }
+        }
+        return options;
+    }
+}
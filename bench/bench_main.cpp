@@ -0,0 +1,278 @@
+#include "bench.hpp"
+#include "../perfbuffer.hpp"
+#include "../sharedperfbuffer.hpp"
+#include "../physics.hpp"
+#include "../collision.hpp"
+#include "../trace.hpp"
+
+#include <memory>
+#include <random>
+
+#ifdef BENCH_WITH_SKIA
+#include "../perfgraph.hpp"
+#include "../ballrenderer.hpp"
+#include "../damage.hpp"
+#include "include/utils/SkNullCanvas.h"
+#endif
+
+// Hot-path microbenchmarks. Needs no Vulkan, GLFW or OpenVR; the perf graph
+// cases are only built when Skia is available (BENCH_WITH_SKIA).
+//
+// Every case builds its state (buffers, scenes, surfaces) before it is added and
+// captures it, so the timed function only runs the operation. State carries over
+// from one repetition to the next, like it does from frame to frame in the app.
+//
+// usage: bench [--filter NAME] [--reps N] [--warmup N] [--min-time SECONDS] [--json FILE]
+
+static std::vector<uint32_t> randomSamples(size_t count, uint32_t range) {
+    std::vector<uint32_t> samples(count);
+    std::mt19937 rng(1234);
+    for (auto& s : samples) {
+        s = rng() % range;
+    }
+    return samples;
+}
+
+static void randomScene(sim::BallStore& balls, sim::WorldParams& world, size_t count) {
+    double area = (world.right - world.left) * (world.floor - world.top);
+    world.radius = std::min(0.05, std::sqrt(0.15 * area / (count * M_PI)));
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> x(world.left + world.radius, world.right - world.radius);
+    std::uniform_real_distribution<double> y(world.top + world.radius, world.floor - world.radius);
+    std::uniform_real_distribution<double> v(-3.0, 3.0);
+    balls.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        balls.posX[i] = x(rng);
+        balls.posY[i] = y(rng);
+        balls.velX[i] = v(rng);
+        balls.velY[i] = v(rng);
+    }
+}
+
+// state for the physics cases, built once when a case is registered
+struct Scene
+{
+    sim::WorldParams world;
+    sim::BallStore balls;
+    sim::BallCollider collider;
+};
+
+static std::shared_ptr<Scene> makeRandomScene(size_t count) {
+    auto scene = std::make_shared<Scene>();
+    randomScene(scene->balls, scene->world, count);
+    return scene;
+}
+
+// the three balls of the default scene
+static void defaultScene(sim::BallStore& balls) {
+    const double velocity[3] = {0, 0.02, 0.08};
+    const double posY[3] = {1.0, 1.5, 3.7};
+    balls.resize(3);
+    for (size_t c = 0; c < 3; ++c) {
+        balls.posX[c] = 1 + c * 1.5;
+        balls.posY[c] = posY[c];
+        balls.velY[c] = velocity[c];
+    }
+}
+
+int main(int argc, char** argv) {
+    bench::Options options = bench::parseOptions(argc, argv);
+    bench::Runner runner;
+
+    const auto samples = randomSamples(1 << 16, 20000);
+    const size_t sampleMask = samples.size() - 1;
+
+    // PerfBuffer
+    for (size_t window : {512, 65536}) {
+        auto buffer = std::make_shared<perf::PerfBuffer>(window);
+        runner.add("PerfBuffer::addSample/" + std::to_string(window), [&, buffer](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                buffer->addSample(samples[i & sampleMask]);
+            }
+            bench::doNotOptimize(buffer->getMax());
+        });
+    }
+    perf::PerfBuffer percentileBuffer(512);
+    for (size_t i = 0; i < 512; ++i) {
+        percentileBuffer.addSample(samples[i]);
+    }
+    runner.add("PerfBuffer::getPercentile/512", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            bench::doNotOptimize(percentileBuffer.getPercentile(99.0));
+        }
+    });
+    perf::SharedPerfBuffer sharedAddBuffer(512);
+    runner.add("SharedPerfBuffer::addSample/512", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            sharedAddBuffer.addSample(samples[i & sampleMask]);
+        }
+    });
+    perf::SharedPerfBuffer snapshotBuffer(512);
+    perf::PerfSnapshot snap;
+    for (size_t i = 0; i < 512; ++i) {
+        snapshotBuffer.addSample(samples[i]);
+    }
+    snapshotBuffer.snapshot(snap);
+    runner.add("SharedPerfBuffer::snapshot/512", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            snapshotBuffer.snapshot(snap);
+            bench::doNotOptimize(snap.samples.data());
+        }
+    });
+    perf::SharedPerfBuffer readBuffer(512);
+    uint64_t readCursor = 0;
+    runner.add("SharedPerfBuffer::readSince/1", [&](uint64_t n) {
+        perf::PerfStats stats;
+        uint32_t out[512];
+        for (uint64_t i = 0; i < n; ++i) {
+            readBuffer.addSample(samples[i & sampleMask]);
+            bench::doNotOptimize(readBuffer.readSince(readCursor, out, 512, stats));
+        }
+    });
+
+    // cost of one traced scope, with tracing off and on
+    for (bool enabled : {false, true}) {
+        runner.add(std::string("TRACE_SCOPE/") + (enabled ? "on" : "off"), [enabled](uint64_t n) {
+            perf::trace::setEnabled(enabled);
+            for (uint64_t i = 0; i < n; ++i) {
+                TRACE_SCOPE("bench");
+                bench::doNotOptimize(i);
+            }
+            perf::trace::setEnabled(false);
+        });
+    }
+
+    // map() and solve_quadratic()
+    runner.add("map", [&](uint64_t n) {
+        uint32_t sum = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            sum += perf::map(samples[i & sampleMask], 100, 19000, 0, 75);
+        }
+        bench::doNotOptimize(sum);
+    });
+    runner.add("solve_quadratic", [&](uint64_t n) {
+        double sum = 0.0;
+        for (uint64_t i = 0; i < n; ++i) {
+            double v = (double)(samples[i & sampleMask] % 1000) / 100.0 - 5.0;
+            auto t = sim::solve_quadratic(4.905, v, -0.5, 0.001);
+            sum += t ? *t : 0.0;
+        }
+        bench::doNotOptimize(sum);
+    });
+
+    // one physics() tick: integrate and resolve ball contacts
+    Scene defaults;
+    defaultScene(defaults.balls);
+    runner.add("physics tick/3 balls", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            sim::step(defaults.balls, defaults.world, 0.001);
+            defaults.collider.resolve(defaults.balls, defaults.world, 0.001);
+        }
+        bench::doNotOptimize(defaults.balls.posY[0]);
+    });
+    for (size_t count : {1000, 100000}) {
+        runner.add("sim::stepScalar/" + std::to_string(count), [count, scene = makeRandomScene(count)](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                sim::stepScalar(scene->balls, scene->world, 0.001, 0, count);
+            }
+            bench::doNotOptimize(scene->balls.posY[0]);
+        });
+        runner.add("sim::step/" + std::to_string(count), [scene = makeRandomScene(count)](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                sim::step(scene->balls, scene->world, 0.001);
+            }
+            bench::doNotOptimize(scene->balls.posY[0]);
+        });
+        runner.add("BallCollider::resolve/" + std::to_string(count), [scene = makeRandomScene(count)](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                sim::step(scene->balls, scene->world, 0.001);
+                scene->collider.resolve(scene->balls, scene->world, 0.001);
+            }
+            bench::doNotOptimize(scene->balls.posY[0]);
+        });
+    }
+
+#ifdef BENCH_WITH_SKIA
+    // the two 512 point perf graph polylines draw() used to rebuild every frame, kept as the baseline
+    SkPath drawPath, physicsPath;
+    runner.add("perf graph SkPath/2x512", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            perf::buildGraphPath(drawPath, samples.data(), 512, 0, 20000, 10, 10, 75);
+            perf::buildGraphPath(physicsPath, samples.data() + 512, 512, 0, 20000, 10, 10, 75);
+            bench::doNotOptimize(drawPath.countPoints() + physicsPath.countPoints());
+        }
+    });
+    // PerfGraph with one new sample per series and frame, drawn into a null canvas
+    perf::SharedPerfBuffer graphDrawTimes(512), graphPhysicsTimes(512);
+    perf::PerfGraph graph(SkRect::MakeXYWH(10, 10, 512, 75), 512);
+    SkPaint graphPaint;
+    graph.addSeries(&graphDrawTimes, graphPaint, graphPaint);
+    graph.addSeries(&graphPhysicsTimes, graphPaint, graphPaint);
+    std::unique_ptr<SkCanvas> nullCanvas = SkMakeNullCanvas();
+    runner.add("perf graph PerfGraph/2x512", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            graphDrawTimes.addSample(samples[i & sampleMask]);
+            graphPhysicsTimes.addSample(samples[(i + 512) & sampleMask]);
+            graph.update();
+            graph.draw(nullCanvas.get(), graphPaint);
+        }
+    });
+
+    // ball drawing on a 640x480 raster surface: one drawCircle per ball vs one drawAtlas batch
+    for (size_t count : {1000, 10000, 100000}) {
+        auto snap = std::make_shared<sim::BallSnapshot>();
+        float radius = 0.0f;
+        {
+            sim::BallStore balls;
+            sim::WorldParams world;
+            randomScene(balls, world, count);
+            radius = (float)world.radius * 100.0f;
+            snap->resize(count);
+            for (size_t i = 0; i < count; ++i) {
+                snap->prevX[i] = snap->posX[i] = (float)balls.posX[i];
+                snap->prevY[i] = snap->posY[i] = (float)balls.posY[i];
+                snap->velY[i] = (float)balls.velY[i];
+            }
+        }
+        auto toPixel = [](float meter) { return meter * 100.0f; };
+        auto surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(640, 480));
+
+        runner.add("draw balls drawCircle/" + std::to_string(count), [=](uint64_t n) {
+            SkPaint paint;
+            paint.setAntiAlias(true);
+            for (uint64_t i = 0; i < n; ++i) {
+                for (size_t c = 0; c < snap->size(); ++c) {
+                    float scaledVelocity = std::clamp(std::abs(snap->velY[c] / 15.0f), 0.0f, 1.0f);
+                    paint.setColor({scaledVelocity, 0.0f, 0.35f, 1.0f});
+                    surface->getCanvas()->drawCircle(toPixel(snap->posX[c]), toPixel(snap->posY[c]), radius, paint);
+                }
+            }
+        });
+        auto renderer = std::make_shared<sim::BallRenderer>();
+        renderer->prepare(radius, nullptr);
+        runner.add("draw balls drawAtlas/" + std::to_string(count), [=](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                renderer->draw(surface->getCanvas(), *snap, 1.0f, toPixel);
+            }
+        });
+        // per-frame damage tracking: mark every ball's tiles, then the region for a buffer two frames old
+        auto damage = std::make_shared<sim::DamageTracker>(640, 480);
+        runner.add("DamageTracker/" + std::to_string(count), [=](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                uint64_t f = damage->beginFrame();
+                for (size_t c = 0; c < snap->size(); ++c) {
+                    float x = toPixel(snap->posX[c]);
+                    float y = toPixel(snap->posY[c]);
+                    damage->add(x - radius - 1, y - radius - 1, x + radius + 1, y + radius + 1);
+                    if (damage->coversAll()) {
+                        break;
+                    }
+                }
+                bench::doNotOptimize(&damage->damage(f > 2 ? f - 2 : 0));
+            }
+        });
+    }
+#endif
+
+    return runner.run(options);
+}
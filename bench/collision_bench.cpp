@@ -0,0 +1,133 @@
+#include "../collision.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+// Ball-to-ball collision cost per step: uniform grid broadphase against the O(n^2)
+// all-pairs baseline. The radius is chosen so the balls cover ~15% of the world,
+// which keeps the contact density the same across body counts.
+// The contact counts of the two differ: resolving a pair moves both balls, so the
+// pairs found later depend on the order they are visited in. Whether the broadphase
+// misses or repeats a pair is checked separately first, on one unresolved snapshot,
+// and a mismatch fails the run with exit code 1.
+//
+// usage: collision_bench [maxBruteForceBodies]
+
+static void initScene(sim::BallStore& balls, sim::WorldParams& world, size_t count) {
+    double area = (world.right - world.left) * (world.floor - world.top);
+    world.radius = std::min(0.05, std::sqrt(0.15 * area / (count * M_PI)));
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> x(world.left + world.radius, world.right - world.radius);
+    std::uniform_real_distribution<double> y(world.top + world.radius, world.floor - world.radius);
+    std::uniform_real_distribution<double> v(-2.0, 2.0);
+    balls.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        balls.posX[i] = x(rng);
+        balls.posY[i] = y(rng);
+        balls.velX[i] = v(rng);
+        balls.velY[i] = v(rng);
+    }
+}
+
+// every pair within contact distance, (i, j) with i < j
+static std::vector<std::pair<uint32_t, uint32_t>> touchingBruteForce(const sim::BallStore& balls, const sim::WorldParams& world) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    for (uint32_t i = 0; i < balls.size(); ++i) {
+        for (uint32_t j = i + 1; j < balls.size(); ++j) {
+            if (sim::touching(balls, world, i, j)) {
+                pairs.emplace_back(i, j);
+            }
+        }
+    }
+    return pairs;
+}
+
+// the same from the grid's candidates, duplicates kept so they show up as a mismatch
+static std::vector<std::pair<uint32_t, uint32_t>> touchingGrid(const sim::BallStore& balls, const sim::WorldParams& world) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    sim::BallCollider collider;
+    collider.forEachCandidatePair(balls, world, [&](uint32_t i, uint32_t j) {
+        if (sim::touching(balls, world, i, j)) {
+            pairs.emplace_back(std::min(i, j), std::max(i, j));
+        }
+    });
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+// the grid has to find exactly the pairs n^2 finds on the same snapshot, taken after
+// settleSteps resolved steps (0: the random start, full of overlaps)
+static bool checkEquivalence(size_t count, int settleSteps) {
+    const double dt = 1.0 / 1000.0;
+    sim::WorldParams world;
+    sim::BallStore balls;
+    initScene(balls, world, count);
+    sim::BallCollider collider;
+    for (int s = 0; s < settleSteps; ++s) {
+        sim::step(balls, world, dt);
+        collider.resolve(balls, world, dt);
+    }
+
+    auto expected = touchingBruteForce(balls, world);
+    auto found = touchingGrid(balls, world);
+    if (found != expected) {
+        fprintf(stderr, "broadphase mismatch at %zu bodies after %d steps: grid finds %zu touching pairs, n^2 finds %zu\n",
+                count, settleSteps, found.size(), expected.size());
+        return false;
+    }
+    printf("broadphase check, %zu bodies after %d steps: %zu touching pairs, same as n^2\n", count, settleSteps, expected.size());
+    return true;
+}
+
+template<typename Resolve>
+double run(size_t count, int steps, size_t& contacts, Resolve resolve) {
+    const double dt = 1.0 / 1000.0;
+    sim::WorldParams world;
+    sim::BallStore balls;
+    initScene(balls, world, count);
+
+    contacts = 0;
+    double seconds = 0.0;
+    for (int s = 0; s < steps; ++s) {
+        sim::step(balls, world, dt);
+        auto start = std::chrono::steady_clock::now();
+        contacts += resolve(balls, world, dt);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return seconds * 1e6 / steps;
+}
+
+int main(int argc, char** argv) {
+    size_t maxBruteForce = argc > 1 ? strtoul(argv[1], nullptr, 10) : 16000;
+
+    for (size_t count : {1000, 16000}) {
+        if (!checkEquivalence(count, 0) || !checkEquivalence(count, 200)) {
+            return 1;
+        }
+    }
+
+    printf("%10s %14s %14s %16s %16s\n", "bodies", "grid us/step", "n^2 us/step", "grid contacts", "n^2 contacts");
+    for (size_t count : {1000, 4000, 16000, 64000, 100000, 250000}) {
+        int steps = std::max<int>(5, (int)(2000000 / count));
+
+        sim::BallCollider collider;
+        size_t gridContacts = 0;
+        double gridUs = run(count, steps, gridContacts, [&](sim::BallStore& b, const sim::WorldParams& w, double dt) {
+            return collider.resolve(b, w, dt);
+        });
+
+        if (count <= maxBruteForce) {
+            size_t bruteContacts = 0;
+            double bruteUs = run(count, steps, bruteContacts, sim::resolveBallsBruteForce);
+            printf("%10zu %14.1f %14.1f %16zu %16zu\n", count, gridUs, bruteUs, gridContacts / steps, bruteContacts / steps);
+        }
+        else {
+            printf("%10zu %14.1f %14s %16zu %16s\n", count, gridUs, "-", gridContacts / steps, "-");
+        }
+    }
+    return 0;
+}
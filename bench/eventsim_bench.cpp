@@ -0,0 +1,76 @@
+#include "../eventsim.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// Compares the event-driven engine with the fixed-step integrator used by physics().
+// Both simulate the same scene for a few seconds; the stepped one ticks at 1 kHz,
+// the event-driven one only fires impacts and evaluates positions at 90 Hz frame times.
+// Positions are compared at every frame and the run fails above the tolerance.
+//
+// usage: eventsim_bench [seconds]
+
+static void initScene(sim::BallStore& balls, const sim::WorldParams& world, size_t count) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> x(world.left + world.radius, world.right - world.radius);
+    std::uniform_real_distribution<double> y(world.top + 0.1, world.floor - world.radius - 0.1);
+    std::uniform_real_distribution<double> v(-3.0, 3.0);
+    balls.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        balls.posX[i] = x(rng);
+        balls.posY[i] = y(rng);
+        balls.velX[i] = v(rng);
+        balls.velY[i] = v(rng);
+    }
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 5.0;
+    const int tickHz = 1000;
+    const int frameHz = 90;
+    const double tolerance = 1e-6;
+
+    sim::WorldParams world;
+    world.radius = 0.05;
+
+    bool agree = true;
+    printf("%10s %14s %14s %10s %12s %12s\n", "bodies", "stepped ms", "events ms", "speedup", "events", "max |dpos|");
+    for (size_t count : {100, 1000, 10000, 100000}) {
+        sim::BallStore stepped, sampled;
+        initScene(stepped, world, count);
+
+        sim::EventSimulator events;
+        events.reset(stepped, world);
+
+        int ticks = (int)(seconds * tickHz);
+        const int ticksPerFrame = tickHz / frameHz;
+        double steppedSeconds = 0.0, eventSeconds = 0.0, maxDiff = 0.0;
+        for (int t = 1; t <= ticks; ++t) {
+            auto start = std::chrono::steady_clock::now();
+            sim::step(stepped, world, 1.0 / tickHz);
+            steppedSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (t % ticksPerFrame == 0) {
+                start = std::chrono::steady_clock::now();
+                events.advanceTo((double)t / tickHz);
+                events.sample(sampled);
+                eventSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                for (size_t i = 0; i < count; ++i) {
+                    maxDiff = std::max(maxDiff, std::abs(stepped.posX[i] - sampled.posX[i]));
+                    maxDiff = std::max(maxDiff, std::abs(stepped.posY[i] - sampled.posY[i]));
+                }
+            }
+        }
+        agree = agree && maxDiff <= tolerance;
+        printf("%10zu %14.2f %14.2f %10.1f %12llu %12.3g\n", count, steppedSeconds * 1e3, eventSeconds * 1e3,
+               steppedSeconds / eventSeconds, (unsigned long long)events.getEventCount(), maxDiff);
+    }
+
+    if (!agree) {
+        fprintf(stderr, "event-driven and stepped results differ by more than %g\n", tolerance);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "../perfbuffer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// Measures the per-sample cost of PerfBuffer::addSample for window sizes from 512 to 1M.
+// Each size is fed with uniformly random samples and with a monotonically rising ramp,
+// which is the worst case for the min window (it grows to the full window size).
+
+template<typename Gen>
+double nsPerSample(size_t windowSize, size_t sampleCount, Gen gen) {
+    perf::PerfBuffer buffer(windowSize);
+    // fill the window once so every measured sample also evicts one
+    for (size_t i = 0; i < windowSize; ++i) {
+        buffer.addSample(gen(i));
+    }
+
+    uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < sampleCount; ++i) {
+        buffer.addSample(gen(i));
+        sink += buffer.getMin() + buffer.getMax();
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    // keep the loop from being optimized away
+    if (sink == 42) {
+        printf(" ");
+    }
+    return std::chrono::duration<double, std::nano>(stop - start).count() / sampleCount;
+}
+
+int main() {
+    const size_t sampleCount = 1 << 22;
+
+    std::vector<uint32_t> randomSamples(sampleCount);
+    std::mt19937 rng(1234);
+    for (auto& s : randomSamples) {
+        s = rng() % 20000;
+    }
+
+    printf("%10s %14s %14s\n", "window", "random ns/op", "ramp ns/op");
+    for (size_t windowSize = 512; windowSize <= (1 << 20); windowSize *= 2) {
+        double random = nsPerSample(windowSize, sampleCount, [&](size_t i) { return randomSamples[i % sampleCount]; });
+        double ramp = nsPerSample(windowSize, sampleCount, [](size_t i) { return (uint32_t)i; });
+        printf("%10zu %14.2f %14.2f\n", windowSize, random, ramp);
+    }
+
+    // cost of the p50/p95/p99/p99.9 queries the overlay makes every frame
+    perf::PerfBuffer buffer(512);
+    for (size_t i = 0; i < sampleCount; ++i) {
+        buffer.addSample(randomSamples[i]);
+    }
+    const int queryCount = 100000;
+    uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queryCount; ++i) {
+        sink += buffer.getPercentile(50.0) + buffer.getPercentile(95.0) + buffer.getPercentile(99.0) + buffer.getPercentile(99.9);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    printf("percentile set (p50/p95/p99/p99.9): %.1f ns (checksum %llu)\n",
+           std::chrono::duration<double, std::nano>(stop - start).count() / queryCount, (unsigned long long)sink);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "../physics.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// Steps the same randomized scene with the scalar reference integrator and the
+// AVX2 kernel, reports ns per body-step for both and the largest divergence
+// between them. Exits non-zero when they disagree by more than the tolerance.
+//
+// usage: physics_bench [steps]
+
+static void initBalls(sim::BallStore& balls, size_t count, const sim::WorldParams& world) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> x(0.5, 5.9), y(world.top + 0.1, world.floor - world.radius - 0.1), v(-5.0, 5.0);
+    balls.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        balls.posX[i] = x(rng);
+        balls.posY[i] = y(rng);
+        balls.velX[i] = v(rng);
+        balls.velY[i] = v(rng);
+    }
+}
+
+template<typename Kernel>
+double run(sim::BallStore& balls, const sim::WorldParams& world, int steps, double dt, Kernel kernel) {
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s) {
+        kernel(balls, world, dt, 0, balls.size());
+    }
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / ((double)steps * balls.size());
+}
+
+int main(int argc, char** argv) {
+    int steps = argc > 1 ? atoi(argv[1]) : 1000;
+    const double dt = 1.0 / 90.0;
+    const double tolerance = 1e-6;
+
+    sim::WorldParams world;
+    world.radius = 0.05;
+
+    bool agree = true;
+    printf("%10s %14s %14s %14s\n", "bodies", "scalar ns", "simd ns", "max |dpos|");
+    for (size_t count : {1000, 10000, 100000, 1000000}) {
+        sim::BallStore scalar, simd;
+        initBalls(scalar, count, world);
+        initBalls(simd, count, world);
+        int n = std::max<int>(1, (int)(steps * 10000 / (double)count));
+
+        double scalarNs = run(scalar, world, n, dt, sim::stepScalar);
+        double simdNs = run(simd, world, n, dt, [](sim::BallStore& b, const sim::WorldParams& w, double t, size_t begin, size_t end) { sim::step(b, w, t, begin, end); });
+
+        double maxDiff = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            maxDiff = std::max(maxDiff, std::abs(scalar.posY[i] - simd.posY[i]));
+            maxDiff = std::max(maxDiff, std::abs(scalar.posX[i] - simd.posX[i]));
+        }
+        agree = agree && maxDiff <= tolerance;
+        printf("%10zu %14.3f %14.3f %14.3g\n", count, scalarNs, simdNs, maxDiff);
+    }
+
+    if (!agree) {
+        fprintf(stderr, "scalar and SIMD kernels disagree by more than %g\n", tolerance);
+        return 1;
+    }
+    return 0;
+}
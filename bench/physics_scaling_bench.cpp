@@ -0,0 +1,80 @@
+#include "../physics.hpp"
+#include "../threadpool.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <cstring>
+#include <vector>
+
+// Headless scaling run for the parallel physics step: for each body count and
+// thread count it reports the time per step, the speedup over one thread and the
+// parallel efficiency (speedup / threads).
+//
+// usage: physics_scaling_bench [maxThreads] [--pin]
+
+int main(int argc, char** argv) {
+    size_t maxThreads = std::thread::hardware_concurrency();
+    bool pin = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--pin") == 0) {
+            pin = true;
+        }
+        else {
+            maxThreads = strtoul(argv[i], nullptr, 10);
+        }
+    }
+    maxThreads = std::max<size_t>(maxThreads, 1);
+
+    const double dt = 1.0 / 1000.0;
+    const size_t grain = 4096;
+    sim::WorldParams world;
+    world.radius = 0.05;
+
+    // powers of two below maxThreads, then maxThreads itself
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    printf("%10s %8s %12s %10s %11s %8s\n", "bodies", "threads", "us/step", "speedup", "efficiency", "steals");
+    for (size_t count : {10000, 100000, 1000000, 4000000}) {
+        double baseline = 0.0;
+        for (size_t threads : threadCounts) {
+            sim::WorkStealingPool pool(threads, pin);
+
+            sim::BallStore balls;
+            balls.resize(count);
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<double> y(0.1, 4.8), v(-5.0, 5.0);
+            for (size_t i = 0; i < count; ++i) {
+                balls.posY[i] = y(rng);
+                balls.velY[i] = v(rng);
+            }
+
+            auto stepAll = [&]() {
+                pool.parallelFor(0, count, grain, [&](size_t b, size_t e) { sim::step(balls, world, dt, b, e); });
+            };
+
+            // warm caches and threads
+            for (int s = 0; s < 5; ++s) {
+                stepAll();
+            }
+            int steps = std::max<int>(10, (int)(20000000 / count));
+            auto start = std::chrono::steady_clock::now();
+            for (int s = 0; s < steps; ++s) {
+                stepAll();
+            }
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / steps;
+
+            if (threads == 1) {
+                baseline = us;
+            }
+            double speedup = baseline / us;
+            printf("%10zu %8zu %12.2f %10.2f %10.0f%% %8llu\n", count, threads, us, speedup, 100.0 * speedup / threads,
+                   (unsigned long long)pool.getStealCount());
+        }
+    }
+    return 0;
+}
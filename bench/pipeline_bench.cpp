@@ -0,0 +1,68 @@
+#include "../pipeline.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+// Frame throughput of pipelined recording (app --record-threads N) without Skia or
+// Vulkan: recording and submitting are stood in for by busy work of the given
+// lengths. With 0 threads a frame is recorded and submitted on the consumer thread,
+// like the app's render thread does; with N the workers record while the consumer
+// submits, so the frame rate approaches 1 / max(submit, record / N) when N + 1 cores
+// are free. The app's numbers depend on how much of Skia's recording parallelizes,
+// this bench shows what the pipeline itself allows and costs.
+//
+// usage: pipeline_bench [recordUs] [submitUs] [frames]
+
+// us of CPU time on the calling thread; time it spends preempted does not count, so
+// work that shares a core is not mistaken for work done in parallel
+static void busy(uint32_t us) {
+    auto cpuNs = []() {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    };
+    uint64_t until = cpuNs() + us * 1000ull;
+    while (cpuNs() < until) {
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t recordUs = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4000;
+    uint32_t submitUs = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000;
+    size_t frames = argc > 3 ? strtoul(argv[3], nullptr, 10) : 500;
+    const size_t depth = 1; // RECORD_QUEUE_DEPTH in the app
+
+    printf("record %u us, submit %u us, %zu frames, %u cores\n", recordUs, submitUs, frames, std::thread::hardware_concurrency());
+    printf("%8s %12s %12s %10s\n", "threads", "frames/s", "ideal", "of ideal");
+    for (size_t threads : {0, 1, 2, 4}) {
+        double ideal = 1e6 / (threads == 0 ? recordUs + submitUs : std::max<double>(submitUs, (double)recordUs / threads));
+        auto start = std::chrono::steady_clock::now();
+        double seconds = 0.0;
+        if (threads == 0) {
+            for (size_t f = 0; f < frames; ++f) {
+                busy(recordUs);
+                busy(submitUs);
+            }
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        else {
+            sim::OrderedPipeline<uint64_t> pipeline(threads, depth, [](size_t, uint64_t) {}, [&](size_t, uint64_t frame) {
+                busy(recordUs);
+                return frame;
+            });
+            uint64_t frame = 0;
+            for (size_t f = 0; f < frames; ++f) {
+                if (!pipeline.next(frame) || frame != f) {
+                    fprintf(stderr, "pipeline handed out frame %llu as %zu\n", (unsigned long long)frame, f);
+                    return 1;
+                }
+                busy(submitUs);
+            }
+            // before the workers are stopped and joined
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        printf("%8zu %12.1f %12.1f %9.0f%%\n", threads, frames / seconds, ideal, 100.0 * frames / seconds / ideal);
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "../sharedperfbuffer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// Stress run for SharedPerfBuffer: one producer publishes a rising ramp while
+// several readers take snapshots and stats concurrently. Every snapshot must be a
+// contiguous piece of the ramp whose max matches its newest sample, otherwise the
+// run fails. Build with -DENABLE_TSAN=ON to run it under ThreadSanitizer.
+//
+// usage: sharedperfbuffer_bench [seconds] [readers]
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int readerCount = argc > 2 ? atoi(argv[2]) : 3;
+
+    perf::SharedPerfBuffer buffer(512);
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> snapshots(0), retries(0), torn(0);
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < readerCount; ++r) {
+        readers.emplace_back([&]() {
+            perf::PerfSnapshot snap;
+            while (running.load(std::memory_order_relaxed)) {
+                if (!buffer.trySnapshot(snap)) {
+                    retries.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                // ramp: zeros until the first sample, then value == sequence + 1
+                bool ok = snap.stats.max == snap.samples.back();
+                for (size_t i = 1; i < snap.samples.size(); ++i) {
+                    if (snap.samples[i - 1] != 0 && snap.samples[i] != snap.samples[i - 1] + 1) {
+                        ok = false;
+                    }
+                }
+                if (snap.stats.sampleCount != snap.samples.back()) {
+                    ok = false;
+                }
+                if (!ok) {
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                }
+                snapshots.fetch_add(1, std::memory_order_relaxed);
+
+                perf::PerfStats stats = buffer.getStats();
+                if (stats.min > stats.p50 || stats.p50 > stats.p99 || stats.p99 > stats.max) {
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    uint64_t produced = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 1000; ++i) {
+            buffer.addSample((uint32_t)++produced);
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    running = false;
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    printf("producer: %llu samples, %.1f ns/sample\n", (unsigned long long)produced, elapsed * 1e9 / produced);
+    printf("readers:  %d threads, %llu snapshots, %llu retries, %llu inconsistent\n", readerCount,
+           (unsigned long long)snapshots.load(), (unsigned long long)retries.load(), (unsigned long long)torn.load());
+    return torn.load() == 0 ? 0 : 1;
+}
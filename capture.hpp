@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace perf
+{
+    // Capture file: a header, a fixed index of up to frameCapacity entries and the
+    // frames' serialized SkPicture data, appended back to back:
+    //   [CaptureHeader][CaptureFrame x frameCapacity][data ...]
+    // The header's frameCount is updated after a frame's data and index entry are in
+    // place, so a file left behind by a crash still holds every frame it counts.
+    struct CaptureHeader
+    {
+        static constexpr uint32_t MAGIC = 0x50414353; // "SCAP"
+        static constexpr uint32_t VERSION = 1;
+
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint64_t frameCapacity;
+        uint64_t frameCount;
+        uint64_t dataEnd; // file offset one past the last frame's data
+    };
+
+    struct CaptureFrame
+    {
+        uint64_t offset; // of the picture data in the file
+        uint64_t size;
+        uint64_t frame; // the app's frame number
+        uint64_t timeNs; // steady clock when the frame was captured
+        uint32_t drawUs; // draw time the app measured for it
+        uint32_t reserved;
+    };
+
+    // Appends frames to a capture file mapped into memory. The file grows in doubling
+    // steps (ftruncate + mremap) and is truncated to what was written on close().
+    class CaptureWriter
+    {
+        public:
+            ~CaptureWriter() {
+                close();
+            }
+
+            bool open(const char* path, uint32_t width, uint32_t height, size_t frameCapacity) {
+                mFd = ::open(path, O_CREAT | O_RDWR | O_TRUNC, 0644);
+                if (mFd < 0) {
+                    fprintf(stderr, "Failed to create capture file %s: %s\n", path, strerror(errno));
+                    return false;
+                }
+                size_t dataStart = sizeof(CaptureHeader) + frameCapacity * sizeof(CaptureFrame);
+                if (!reserve(dataStart + INITIAL_DATA_SIZE)) {
+                    fprintf(stderr, "Failed to map capture file %s: %s\n", path, strerror(errno));
+                    close();
+                    return false;
+                }
+                mPath = path;
+                CaptureHeader* header = getHeader();
+                header->magic = CaptureHeader::MAGIC;
+                header->version = CaptureHeader::VERSION;
+                header->width = width;
+                header->height = height;
+                header->frameCapacity = frameCapacity;
+                header->frameCount = 0;
+                header->dataEnd = dataStart;
+                return true;
+            }
+
+            // copies one frame's picture data in; false once the index is full or the file cannot grow
+            bool append(const void* data, size_t size, uint64_t frame, uint32_t drawUs) {
+                if (!mMapping || isFull()) {
+                    return false;
+                }
+                CaptureHeader* header = getHeader();
+                uint64_t offset = header->dataEnd;
+                if (offset + size > mMapped && !reserve(std::max<size_t>(mMapped * 2, offset + size))) {
+                    fprintf(stderr, "Failed to grow capture file %s: %s\n", mPath.c_str(), strerror(errno));
+                    return false;
+                }
+                header = getHeader();
+                memcpy(mMapping + offset, data, size);
+                CaptureFrame& entry = reinterpret_cast<CaptureFrame*>(mMapping + sizeof(CaptureHeader))[header->frameCount];
+                entry.offset = offset;
+                entry.size = size;
+                entry.frame = frame;
+                entry.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                entry.drawUs = drawUs;
+                entry.reserved = 0;
+                header->dataEnd = offset + size;
+                header->frameCount++;
+                return true;
+            }
+
+            bool isOpen() const { return mMapping != nullptr; }
+            bool isFull() const { return mMapping && getHeader()->frameCount == getHeader()->frameCapacity; }
+            uint64_t getFrameCount() const { return mMapping ? getHeader()->frameCount : 0; }
+            uint64_t getBytes() const { return mMapping ? getHeader()->dataEnd : 0; }
+
+            void close() {
+                if (mMapping) {
+                    uint64_t end = getHeader()->dataEnd;
+                    munmap(mMapping, mMapped);
+                    mMapping = nullptr;
+                    if (ftruncate(mFd, end) != 0) {
+                        fprintf(stderr, "Failed to truncate capture file %s: %s\n", mPath.c_str(), strerror(errno));
+                    }
+                }
+                if (mFd >= 0) {
+                    ::close(mFd);
+                    mFd = -1;
+                }
+                mMapped = 0;
+            }
+
+        private:
+            static constexpr size_t INITIAL_DATA_SIZE = 64 << 20;
+
+            bool reserve(size_t size) {
+                if (ftruncate(mFd, size) != 0) {
+                    return false;
+                }
+                void* mapping = mMapping ? mremap(mMapping, mMapped, size, MREMAP_MAYMOVE)
+                                         : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+                if (mapping == MAP_FAILED) {
+                    return false;
+                }
+                mMapping = static_cast<uint8_t*>(mapping);
+                mMapped = size;
+                return true;
+            }
+
+            CaptureHeader* getHeader() const { return reinterpret_cast<CaptureHeader*>(mMapping); }
+
+            std::string mPath;
+            int mFd = -1;
+            uint8_t* mMapping = nullptr;
+            size_t mMapped = 0;
+    };
+
+    // Maps a capture file read-only; frames point straight into the mapping.
+    class CaptureReader
+    {
+        public:
+            ~CaptureReader() {
+                close();
+            }
+
+            bool open(const char* path) {
+                int fd = ::open(path, O_RDONLY);
+                if (fd < 0) {
+                    fprintf(stderr, "Failed to open capture file %s: %s\n", path, strerror(errno));
+                    return false;
+                }
+                struct stat info;
+                if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CaptureHeader)) {
+                    fprintf(stderr, "%s is not a capture file\n", path);
+                    ::close(fd);
+                    return false;
+                }
+                void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                ::close(fd);
+                if (mapping == MAP_FAILED) {
+                    fprintf(stderr, "Failed to map capture file %s: %s\n", path, strerror(errno));
+                    return false;
+                }
+                mMapping = static_cast<const uint8_t*>(mapping);
+                mSize = info.st_size;
+
+                const CaptureHeader* header = getHeader();
+                if (header->magic != CaptureHeader::MAGIC || header->version != CaptureHeader::VERSION || !framesValid()) {
+                    fprintf(stderr, "%s is not a capture file or is damaged\n", path);
+                    close();
+                    return false;
+                }
+                return true;
+            }
+
+            void close() {
+                if (mMapping) {
+                    munmap(const_cast<uint8_t*>(mMapping), mSize);
+                    mMapping = nullptr;
+                }
+            }
+
+            uint32_t getWidth() const { return getHeader()->width; }
+            uint32_t getHeight() const { return getHeader()->height; }
+            size_t getFrameCount() const { return getHeader()->frameCount; }
+            const CaptureFrame& getFrame(size_t i) const { return getFrames()[i]; }
+            const void* getData(size_t i) const { return mMapping + getFrames()[i].offset; }
+
+        private:
+            const CaptureHeader* getHeader() const { return reinterpret_cast<const CaptureHeader*>(mMapping); }
+            const CaptureFrame* getFrames() const { return reinterpret_cast<const CaptureFrame*>(mMapping + sizeof(CaptureHeader)); }
+
+            // the index and every frame's data lie inside the file
+            bool framesValid() const {
+                const CaptureHeader* header = getHeader();
+                if (header->frameCount > header->frameCapacity || header->frameCapacity > (mSize - sizeof(CaptureHeader)) / sizeof(CaptureFrame)) {
+                    return false;
+                }
+                for (size_t i = 0; i < header->frameCount; ++i) {
+                    const CaptureFrame& frame = getFrames()[i];
+                    if (frame.offset > mSize || frame.size > mSize - frame.offset) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            const uint8_t* mMapping = nullptr;
+            size_t mSize = 0;
+    };
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "physics.hpp"
+
+namespace sim
+{
+    // true if the pair overlaps, the test every resolve starts with
+    inline bool touching(const BallStore& balls, const WorldParams& world, size_t i, size_t j) {
+        const double minDist = 2.0 * world.radius;
+        double dx = balls.posX[j] - balls.posX[i];
+        double dy = balls.posY[j] - balls.posY[i];
+        return dx * dx + dy * dy < minDist * minDist;
+    }
+
+    // Resolves one ball pair after an integration step. Gravity is the same for both
+    // balls, so their relative motion is linear and the time of impact solves
+    //   |d + u*t|^2 = (2r)^2  with d, u the relative position and velocity.
+    // Looking back in time (t = -s) gives a*s^2 - b*s + c = 0, which solve_quadratic
+    // answers. Both balls are rewound to the contact, exchange their normal velocity
+    // (equal mass, elastic) and are advanced by the rewound time again.
+    // Returns true if the pair was in contact.
+    inline bool resolveBallPair(BallStore& balls, const WorldParams& world, double dt, size_t i, size_t j) {
+        const double minDist = 2.0 * world.radius;
+        double dx = balls.posX[j] - balls.posX[i];
+        double dy = balls.posY[j] - balls.posY[i];
+        double distSq = dx * dx + dy * dy;
+        if (distSq >= minDist * minDist) {
+            return false;
+        }
+
+        double ux = balls.velX[j] - balls.velX[i];
+        double uy = balls.velY[j] - balls.velY[i];
+        double approach = dx * ux + dy * uy;
+
+        double a = ux * ux + uy * uy;
+        double b = 2.0 * approach;
+        double c = distSq - minDist * minDist;
+        auto back = a > 0.0 && approach < 0.0 ? solve_quadratic(a, -b, c, dt) : std::nullopt;
+
+        if (!back) {
+            // separating already, or overlapping since before this step: push apart
+            double dist = std::sqrt(distSq);
+            double nx = dist > 0.0 ? dx / dist : 1.0;
+            double ny = dist > 0.0 ? dy / dist : 0.0;
+            double push = 0.5 * (minDist - dist);
+            balls.posX[i] -= nx * push;
+            balls.posY[i] -= ny * push;
+            balls.posX[j] += nx * push;
+            balls.posY[j] += ny * push;
+            return true;
+        }
+
+        // rewind both balls to the moment of contact
+        double s = *back;
+        double aa = 0.5 * world.gravity;
+        double xi = balls.posX[i] - balls.velX[i] * s;
+        double xj = balls.posX[j] - balls.velX[j] * s;
+        double yi = balls.posY[i] - balls.velY[i] * s + aa * s * s;
+        double yj = balls.posY[j] - balls.velY[j] * s + aa * s * s;
+        double vyi = balls.velY[i] - world.gravity * s;
+        double vyj = balls.velY[j] - world.gravity * s;
+
+        // exchange the velocity components along the contact normal
+        double nx = (xj - xi) / minDist;
+        double ny = (yj - yi) / minDist;
+        double impulse = (balls.velX[j] - balls.velX[i]) * nx + (vyj - vyi) * ny;
+        double vxi = balls.velX[i] + impulse * nx;
+        double vxj = balls.velX[j] - impulse * nx;
+        vyi += impulse * ny;
+        vyj -= impulse * ny;
+
+        // and advance them again by the rewound time
+        balls.posX[i] = xi + vxi * s;
+        balls.posX[j] = xj + vxj * s;
+        balls.posY[i] = yi + vyi * s + aa * s * s;
+        balls.posY[j] = yj + vyj * s + aa * s * s;
+        balls.velX[i] = vxi;
+        balls.velX[j] = vxj;
+        balls.velY[i] = vyi + world.gravity * s;
+        balls.velY[j] = vyj + world.gravity * s;
+        return true;
+    }
+
+    inline void clampToWorld(BallStore& balls, const WorldParams& world, size_t i) {
+        balls.posX[i] = std::clamp(balls.posX[i], world.left + world.radius, world.right - world.radius);
+        balls.posY[i] = std::clamp(balls.posY[i], world.top, world.floor - world.radius);
+    }
+
+    // Ball-to-ball collisions with a uniform grid broadphase.
+    // Cells are one ball diameter wide, so touching balls are always in the same or
+    // a neighbouring cell. The grid is rebuilt every step with a counting sort into
+    // flat arrays that are only reallocated when the ball count or world size changes.
+    class BallCollider
+    {
+        public:
+            // returns the number of pairs in contact
+            size_t resolve(BallStore& balls, const WorldParams& world, double dt) {
+                size_t contacts = 0;
+                forEachCandidatePair(balls, world, [&](uint32_t i, uint32_t j) {
+                    contacts += resolveBallPair(balls, world, dt, i, j);
+                });
+
+                for (size_t i = 0; i < balls.size(); ++i) {
+                    clampToWorld(balls, world, i);
+                }
+                return contacts;
+            }
+
+            // Rebuilds the grid and calls visit(i, j) once for every pair in the same or
+            // neighbouring cells, the superset of the touching pairs that resolve() tests.
+            template<typename Visit>
+            void forEachCandidatePair(const BallStore& balls, const WorldParams& world, Visit&& visit) {
+                build(balls, world);
+
+                for (uint32_t cy = 0; cy < mCellsY; ++cy) {
+                    for (uint32_t cx = 0; cx < mCellsX; ++cx) {
+                        uint32_t cell = cy * mCellsX + cx;
+                        for (uint32_t a = mCellStart[cell]; a < mCellStart[cell + 1]; ++a) {
+                            uint32_t i = mCellItems[a];
+                            // same cell, every pair once
+                            for (uint32_t b = a + 1; b < mCellStart[cell + 1]; ++b) {
+                                visit(i, mCellItems[b]);
+                            }
+                            // forward half of the neighbourhood: right, and the row below
+                            visitCell(i, cx + 1, cy, visit);
+                            visitCell(i, cx - 1, cy + 1, visit);
+                            visitCell(i, cx, cy + 1, visit);
+                            visitCell(i, cx + 1, cy + 1, visit);
+                        }
+                    }
+                }
+            }
+
+        private:
+            template<typename Visit>
+            void visitCell(uint32_t i, uint32_t cx, uint32_t cy, Visit& visit) const {
+                // unsigned wrap-around takes care of cx - 1 at the left edge
+                if (cx >= mCellsX || cy >= mCellsY) {
+                    return;
+                }
+                uint32_t cell = cy * mCellsX + cx;
+                for (uint32_t b = mCellStart[cell]; b < mCellStart[cell + 1]; ++b) {
+                    visit(i, mCellItems[b]);
+                }
+            }
+
+            uint32_t cellOf(double x, double y) const {
+                uint32_t cx = (uint32_t)std::clamp((x - mOriginX) * mInvCellSize, 0.0, (double)(mCellsX - 1));
+                uint32_t cy = (uint32_t)std::clamp((y - mOriginY) * mInvCellSize, 0.0, (double)(mCellsY - 1));
+                return cy * mCellsX + cx;
+            }
+
+            void build(const BallStore& balls, const WorldParams& world) {
+                double cellSize = std::max(2.0 * world.radius, 1e-6);
+                mOriginX = world.left;
+                mOriginY = std::min(world.top, world.floor);
+                mInvCellSize = 1.0 / cellSize;
+                mCellsX = std::max<uint32_t>(1, (uint32_t)std::ceil((world.right - world.left) / cellSize));
+                mCellsY = std::max<uint32_t>(1, (uint32_t)std::ceil(std::abs(world.floor - world.top) / cellSize));
+
+                size_t cellCount = (size_t)mCellsX * mCellsY;
+                mCellStart.resize(cellCount + 1);
+                mBallCell.resize(balls.size());
+                mCellItems.resize(balls.size());
+
+                // counting sort: per-cell counts, inclusive prefix sum (cell ends),
+                // then a backwards scatter that walks every end down to its start
+                std::fill(mCellStart.begin(), mCellStart.end(), 0);
+                for (size_t i = 0; i < balls.size(); ++i) {
+                    uint32_t cell = cellOf(balls.posX[i], balls.posY[i]);
+                    mBallCell[i] = cell;
+                    mCellStart[cell]++;
+                }
+                for (size_t c = 1; c < cellCount; ++c) {
+                    mCellStart[c] += mCellStart[c - 1];
+                }
+                for (size_t i = balls.size(); i-- > 0;) {
+                    mCellItems[--mCellStart[mBallCell[i]]] = (uint32_t)i;
+                }
+                mCellStart[cellCount] = (uint32_t)balls.size();
+            }
+
+            double mOriginX = 0.0;
+            double mOriginY = 0.0;
+            double mInvCellSize = 1.0;
+            uint32_t mCellsX = 1;
+            uint32_t mCellsY = 1;
+            std::vector<uint32_t> mCellStart; // cell c holds mCellItems[mCellStart[c] .. mCellStart[c + 1])
+            std::vector<uint32_t> mCellItems;
+            std::vector<uint32_t> mBallCell;
+    };
+
+    // O(n^2) reference for the broadphase, only sensible for small scenes and benchmarks
+    inline size_t resolveBallsBruteForce(BallStore& balls, const WorldParams& world, double dt) {
+        size_t contacts = 0;
+        for (size_t i = 0; i < balls.size(); ++i) {
+            for (size_t j = i + 1; j < balls.size(); ++j) {
+                contacts += resolveBallPair(balls, world, dt, i, j);
+            }
+        }
+        for (size_t i = 0; i < balls.size(); ++i) {
+            clampToWorld(balls, world, i);
+        }
+        return contacts;
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <array>
+#include <vector>
+#include <algorithm>
+
+#include "include/core/SkRect.h"
+#include "include/core/SkRegion.h"
+
+namespace sim
+{
+    // Which parts of a frame have content, on a grid of TILE_SIZE pixel tiles, so only
+    // the changed parts need to be redrawn. Against a static background a buffer that
+    // still holds frame F differs from the new frame only where one of the two has
+    // content, so the damage for it is this frame's tiles plus frame F's tiles; the
+    // frames in between do not matter. Swapchain images rotate, so the caller keeps
+    // the frame number each buffer holds (its age). Buffers that were never drawn or
+    // hold a frame older than MAX_AGE are redrawn in full.
+    class DamageTracker
+    {
+        public:
+            static constexpr int TILE_SIZE = 32;
+            static constexpr uint64_t MAX_AGE = 8;
+
+            DamageTracker(int width, int height)
+                : mWidth(width), mHeight(height), mColumns((width + TILE_SIZE - 1) / TILE_SIZE), mRows((height + TILE_SIZE - 1) / TILE_SIZE) {
+                for (auto& tiles : mHistory) {
+                    tiles.assign(mColumns * mRows, 0);
+                }
+                // the most runs there can be: every other tile of every row
+                mRects.reserve((size_t)mRows * ((mColumns + 1) / 2));
+            }
+
+            // starts a frame with no content; returns its number (from 1) to store with the buffer it goes into
+            uint64_t beginFrame() {
+                mFrame++;
+                std::fill(current().begin(), current().end(), 0);
+                mCovered = 0;
+                return mFrame;
+            }
+
+            // marks a rect in pixels as covered in this frame, clipped to the frame
+            void add(float left, float top, float right, float bottom) {
+                if (!(left < right && top < bottom) || right <= 0.0f || bottom <= 0.0f || left >= mWidth || top >= mHeight) {
+                    return;
+                }
+                int x0 = (int)std::max(left, 0.0f) / TILE_SIZE;
+                int y0 = (int)std::max(top, 0.0f) / TILE_SIZE;
+                int x1 = ((int)std::ceil(std::min(right, (float)mWidth)) - 1) / TILE_SIZE;
+                int y1 = ((int)std::ceil(std::min(bottom, (float)mHeight)) - 1) / TILE_SIZE;
+                std::vector<uint8_t>& tiles = current();
+                for (int y = y0; y <= y1; ++y) {
+                    for (int x = x0; x <= x1; ++x) {
+                        mCovered += !tiles[y * mColumns + x];
+                        tiles[y * mColumns + x] = 1;
+                    }
+                }
+            }
+
+            void add(const SkRect& rect) {
+                add(rect.left(), rect.top(), rect.right(), rect.bottom());
+            }
+
+            // every tile of this frame has content, further add() calls change nothing
+            bool coversAll() const { return mCovered == (size_t)mColumns * mRows; }
+
+            // Region to redraw into a buffer that holds frame bufferFrame (0 if it was never
+            // drawn), as one rect per run of damaged tiles in a row. The runs are collected in
+            // pre-sized storage and handed to the region at once, so the region is built with
+            // one allocation instead of growing with every run.
+            const SkRegion& damage(uint64_t bufferFrame) {
+                mRegion.setEmpty();
+                mRects.clear();
+                mPixels = 0;
+                if (bufferFrame == 0 || bufferFrame >= mFrame || mFrame - bufferFrame > MAX_AGE || coversAll()) {
+                    mRegion.setRect(SkIRect::MakeWH(mWidth, mHeight));
+                    mPixels = (size_t)mWidth * mHeight;
+                    return mRegion;
+                }
+
+                const std::vector<uint8_t>& now = current();
+                const std::vector<uint8_t>& then = mHistory[bufferFrame % mHistory.size()];
+                for (int y = 0; y < mRows; ++y) {
+                    const size_t row = (size_t)y * mColumns;
+                    for (int x = 0; x < mColumns; ) {
+                        if (!(now[row + x] | then[row + x])) {
+                            x++;
+                            continue;
+                        }
+                        int start = x;
+                        while (x < mColumns && (now[row + x] | then[row + x])) {
+                            x++;
+                        }
+                        SkIRect rect = SkIRect::MakeLTRB(start * TILE_SIZE, y * TILE_SIZE, std::min(x * TILE_SIZE, mWidth), std::min((y + 1) * TILE_SIZE, mHeight));
+                        mRects.push_back(rect);
+                        mPixels += (size_t)rect.width() * rect.height();
+                    }
+                }
+                mRegion.setRects(mRects.data(), (int)mRects.size());
+                return mRegion;
+            }
+
+            // pixels covered by the last damage()
+            size_t getPixels() const { return mPixels; }
+            bool isFull() const { return mPixels == (size_t)mWidth * mHeight; }
+
+        private:
+            std::vector<uint8_t>& current() { return mHistory[mFrame % mHistory.size()]; }
+
+            int mWidth;
+            int mHeight;
+            int mColumns;
+            int mRows;
+            uint64_t mFrame = 0;
+            size_t mCovered = 0; // tiles set in the current frame
+            std::array<std::vector<uint8_t>, MAX_AGE + 1> mHistory;
+            SkRegion mRegion;
+            std::vector<SkIRect> mRects; // runs of the last damage()
+            size_t mPixels = 0;
+    };
+}
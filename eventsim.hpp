@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "physics.hpp"
+
+namespace sim
+{
+    // Event-driven alternative to stepping every body every tick.
+    // Between wall impacts a ball moves on an exact parabola, so each body only stores
+    // its state at its last impact and the time of its next one. A min-heap orders the
+    // next impacts of all bodies; advanceTo() fires the due ones and sample() evaluates
+    // positions in closed form when a frame needs them. Balls do not interact with each
+    // other in this mode, so every body has exactly one pending event at any time.
+    class EventSimulator
+    {
+        public:
+            void reset(const BallStore& balls, const WorldParams& world, double time = 0.0) {
+                mWorld = world;
+                mTime = time;
+                mEventCount = 0;
+                mBodies.resize(balls.size());
+                mHeap.clear();
+                mHeap.reserve(balls.size());
+                for (size_t i = 0; i < balls.size(); ++i) {
+                    mBodies[i] = {time, balls.posX[i], balls.posY[i], balls.velX[i], balls.velY[i]};
+                    mHeap.push_back(nextEvent((uint32_t)i));
+                }
+                std::make_heap(mHeap.begin(), mHeap.end(), Later());
+            }
+
+            // fire every impact up to and including time
+            void advanceTo(double time) {
+                while (!mHeap.empty() && mHeap.front().time <= time) {
+                    std::pop_heap(mHeap.begin(), mHeap.end(), Later());
+                    Event& event = mHeap.back();
+                    bounce(event);
+                    event = nextEvent(event.body);
+                    std::push_heap(mHeap.begin(), mHeap.end(), Later());
+                    mEventCount++;
+                }
+                mTime = time;
+            }
+
+            // state of body i at time; valid for times up to the body's next impact,
+            // which advanceTo(time) guarantees
+            void stateAt(size_t i, double time, double& x, double& y, double& vx, double& vy) const {
+                const Body& b = mBodies[i];
+                double t = time - b.t0;
+                x = b.x0 + b.vx * t;
+                y = b.y0 + b.vy * t + 0.5 * mWorld.gravity * t * t;
+                vx = b.vx;
+                vy = b.vy + mWorld.gravity * t;
+            }
+
+            // writes all bodies at the current time into out
+            void sample(BallStore& out) const {
+                out.resize(mBodies.size());
+                for (size_t i = 0; i < mBodies.size(); ++i) {
+                    stateAt(i, mTime, out.posX[i], out.posY[i], out.velX[i], out.velY[i]);
+                }
+            }
+
+            double getTime() const { return mTime; }
+            uint64_t getEventCount() const { return mEventCount; }
+
+        private:
+            enum Wall : uint32_t { WALL_TOP, WALL_BOTTOM, WALL_LEFT, WALL_RIGHT, WALL_NONE };
+
+            struct Body
+            {
+                double t0; // time of the last impact (or reset)
+                double x0;
+                double y0;
+                double vx;
+                double vy;
+            };
+
+            struct Event
+            {
+                double time;
+                uint32_t body;
+                Wall wall;
+            };
+
+            struct Later
+            {
+                bool operator()(const Event& a, const Event& b) const { return a.time > b.time; }
+            };
+
+            Event nextEvent(uint32_t i) const {
+                const Body& b = mBodies[i];
+                const double inf = std::numeric_limits<double>::infinity();
+                const double aa = 0.5 * mWorld.gravity;
+                Event event{inf, i, WALL_NONE};
+
+                auto consider = [&](std::optional<double> dt, Wall wall) {
+                    if (dt && b.t0 + *dt < event.time) {
+                        event.time = b.t0 + *dt;
+                        event.wall = wall;
+                    }
+                };
+                consider(solve_quadratic(aa, b.vy, b.y0 - (mWorld.floor - mWorld.radius), inf), WALL_BOTTOM);
+                consider(solve_quadratic(aa, b.vy, b.y0 - mWorld.top, inf), WALL_TOP);
+                if (b.vx < 0.0) {
+                    consider((mWorld.left + mWorld.radius - b.x0) / b.vx, WALL_LEFT);
+                }
+                else if (b.vx > 0.0) {
+                    consider((mWorld.right - mWorld.radius - b.x0) / b.vx, WALL_RIGHT);
+                }
+                return event;
+            }
+
+            void bounce(const Event& event) {
+                Body& b = mBodies[event.body];
+                double x, y, vx, vy;
+                stateAt(event.body, event.time, x, y, vx, vy);
+
+                // snap onto the wall so the root at the impact itself is exactly zero
+                // and not found again as the next event
+                switch (event.wall) {
+                    case WALL_TOP: y = mWorld.top; vy = -vy; break;
+                    case WALL_BOTTOM: y = mWorld.floor - mWorld.radius; vy = -vy; break;
+                    case WALL_LEFT: x = mWorld.left + mWorld.radius; vx = -vx; break;
+                    case WALL_RIGHT: x = mWorld.right - mWorld.radius; vx = -vx; break;
+                    case WALL_NONE: break;
+                }
+                b = {event.time, x, y, vx, vy};
+            }
+
+            WorldParams mWorld;
+            double mTime = 0.0;
+            uint64_t mEventCount = 0;
+            std::vector<Body> mBodies;
+            std::vector<Event> mHeap;
+    };
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace perf
+{
+    // GPU time per frame from a pair of timestamp queries around the frame's work on
+    // the queue. A command buffer submitted before the work writes the first timestamp,
+    // one queued after it in a batch without waits, ahead of the submit that signals the
+    // slot's fence, writes the second, both at BOTTOM_OF_PIPE. A timestamp is only
+    // written once everything submitted before it on the queue has passed that stage,
+    // so the first marks when the GPU is done with earlier frames and the difference is
+    // what this frame cost the GPU, idle time while the CPU was still recording
+    // excluded. If the frame's work waits on a semaphore (the swapchain acquire), the
+    // first batch takes that wait and signals one the work waits on instead, so time
+    // spent waiting for the presentation engine is not counted either. One pair per
+    // frame in flight, read back once the slot's fence has signalled, i.e.
+    // framesInFlight frames later.
+    class GpuFrameTimer
+    {
+        public:
+            ~GpuFrameTimer() {
+                destroy();
+            }
+
+            bool init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t slots) {
+                VkPhysicalDeviceProperties properties;
+                vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+                uint32_t familyCount = 0;
+                vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+                std::vector<VkQueueFamilyProperties> families(familyCount);
+                vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+                uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+                if (validBits == 0 || properties.limits.timestampPeriod <= 0.0f) {
+                    fprintf(stderr, "The graphics queue does not support timestamps\n");
+                    return false;
+                }
+                mDevice = device;
+                mNsPerTick = properties.limits.timestampPeriod;
+                mMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+                VkQueryPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+                poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+                poolInfo.queryCount = 2 * slots;
+                VkCommandPoolCreateInfo commandPoolInfo{};
+                commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+                commandPoolInfo.queueFamilyIndex = queueFamily;
+                if (vkCreateQueryPool(device, &poolInfo, nullptr, &mQueryPool) != VK_SUCCESS ||
+                    vkCreateCommandPool(device, &commandPoolInfo, nullptr, &mCommandPool) != VK_SUCCESS) {
+                    fprintf(stderr, "Failed to create the GPU timer's query or command pool\n");
+                    destroy();
+                    return false;
+                }
+
+                std::vector<VkCommandBuffer> buffers(2 * slots);
+                VkCommandBufferAllocateInfo allocateInfo{};
+                allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                allocateInfo.commandPool = mCommandPool;
+                allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                allocateInfo.commandBufferCount = 2 * slots;
+                if (vkAllocateCommandBuffers(device, &allocateInfo, buffers.data()) != VK_SUCCESS) {
+                    fprintf(stderr, "Failed to allocate the GPU timer's command buffers\n");
+                    destroy();
+                    return false;
+                }
+
+                // recorded once; a slot's buffers are resubmitted whenever the slot comes round
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                mSlots.resize(slots);
+                for (uint32_t s = 0; s < slots; ++s) {
+                    Slot& slot = mSlots[s];
+                    slot.begin = buffers[2 * s];
+                    slot.end = buffers[2 * s + 1];
+                    vkBeginCommandBuffer(slot.begin, &beginInfo);
+                    vkCmdResetQueryPool(slot.begin, mQueryPool, 2 * s, 2);
+                    vkCmdWriteTimestamp(slot.begin, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mQueryPool, 2 * s);
+                    vkEndCommandBuffer(slot.begin);
+                    vkBeginCommandBuffer(slot.end, &beginInfo);
+                    vkCmdWriteTimestamp(slot.end, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mQueryPool, 2 * s + 1);
+                    vkEndCommandBuffer(slot.end);
+                }
+                return true;
+            }
+
+            bool isOpen() const { return mQueryPool != VK_NULL_HANDLE; }
+
+            // before the frame's work is submitted; the slot's previous frame must be done. With
+            // wait set, the timestamp is written after it and signal is signalled for the work
+            bool begin(VkQueue queue, uint32_t slot, VkSemaphore wait = VK_NULL_HANDLE, VkSemaphore signal = VK_NULL_HANDLE) {
+                VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                VkSubmitInfo submitInfo{};
+                submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+                submitInfo.waitSemaphoreCount = wait != VK_NULL_HANDLE ? 1 : 0;
+                submitInfo.pWaitSemaphores = &wait;
+                submitInfo.pWaitDstStageMask = &waitStage;
+                submitInfo.commandBufferCount = 1;
+                submitInfo.pCommandBuffers = &mSlots[slot].begin;
+                submitInfo.signalSemaphoreCount = signal != VK_NULL_HANDLE ? 1 : 0;
+                submitInfo.pSignalSemaphores = &signal;
+                mSlots[slot].pending = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) == VK_SUCCESS;
+                return mSlots[slot].pending;
+            }
+
+            // to be submitted on its own after the frame's work and before the submit that signals the slot's fence
+            const VkCommandBuffer* getEndCommandBuffer(uint32_t slot) const { return &mSlots[slot].end; }
+
+            // once the slot's fence has signalled; false if the slot holds no new frame
+            bool read(uint32_t slot, uint32_t& us) {
+                if (!mSlots[slot].pending) {
+                    return false;
+                }
+                uint64_t ticks[2];
+                if (vkGetQueryPoolResults(mDevice, mQueryPool, 2 * slot, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+                    return false;
+                }
+                mSlots[slot].pending = false;
+                us = (uint32_t)(((ticks[1] - ticks[0]) & mMask) * mNsPerTick / 1000.0);
+                return true;
+            }
+
+            // the device has to be idle
+            void destroy() {
+                if (mCommandPool != VK_NULL_HANDLE) {
+                    vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+                    mCommandPool = VK_NULL_HANDLE;
+                }
+                if (mQueryPool != VK_NULL_HANDLE) {
+                    vkDestroyQueryPool(mDevice, mQueryPool, nullptr);
+                    mQueryPool = VK_NULL_HANDLE;
+                }
+                mSlots.clear();
+            }
+
+        private:
+            struct Slot
+            {
+                VkCommandBuffer begin = VK_NULL_HANDLE;
+                VkCommandBuffer end = VK_NULL_HANDLE;
+                bool pending = false; // submitted and not read back yet
+            };
+
+            VkDevice mDevice = VK_NULL_HANDLE;
+            VkQueryPool mQueryPool = VK_NULL_HANDLE;
+            VkCommandPool mCommandPool = VK_NULL_HANDLE;
+            std::vector<Slot> mSlots;
+            double mNsPerTick = 1.0;
+            uint64_t mMask = ~0ull;
+    };
+}
@@ -1,20 +1,44 @@
 #include <chrono>
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
-#include "perfbuffer.hpp"
+#include "sharedperfbuffer.hpp"
+#include "physics.hpp"
+#include "collision.hpp"
+#include "eventsim.hpp"
+#include "triplebuffer.hpp"
+#include "threadpool.hpp"
+#include "perfgraph.hpp"
+#include "ballrenderer.hpp"
+#include "resolution.hpp"
+#include "gputimer.hpp"
+#include "pipelinecache.hpp"
+#include "phasetimer.hpp"
+#include "trace.hpp"
+#include "pipeline.hpp"
+#include "damage.hpp"
+#include "overlay.hpp"
+#include "scheduler.hpp"
+#include "metricsshm.hpp"
+#include "capture.hpp"
+#include "alloccount.hpp"
 #include <cmath>
 #include <algorithm>
 #include <thread>
+#include <random>
+#include <cstring>
 
 #include "include/gpu/vk/VulkanTypes.h"
 #include "include/gpu/vk/VulkanBackendContext.h"
 #include "include/gpu/vk/VulkanExtensions.h"
 #include "include/gpu/vk/VulkanPreferredFeatures.h"
+#include "include/gpu/vk/VulkanMutableTextureState.h"
+#include "include/gpu/MutableTextureState.h"
 #include "include/encode/SkPngEncoder.h"
 
 #include "include/gpu/graphite/Context.h"
 #include "include/gpu/graphite/ContextOptions.h"
 #include "include/gpu/graphite/Surface.h"
+#include "include/gpu/graphite/BackendSemaphore.h"
 #include "include/gpu/graphite/BackendTexture.h"
 #include "include/gpu/graphite/TextureInfo.h"
 #include "include/gpu/graphite/vk/VulkanGraphiteContext.h"
@@ -29,12 +53,49 @@
 #include "include/core/SkPath.h"
 #include "include/core/SkData.h"
 #include "include/core/SkStream.h"
+#include "include/core/SkPixmap.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/core/SkSerialProcs.h"
 
 #include "openvr/openvr.h"
 
 
+// size of the swapchain images, the OpenVR texture and the headless surface
+#define RENDER_WIDTH 640
+#define RENDER_HEIGHT 480
+
+// runtime log level: LOG_INFO prints a startup summary, LOG_VERBOSE also every extension,
+// queue family and Vulkan proc lookup. Errors always go to stderr
+enum LogLevel { LOG_QUIET, LOG_INFO, LOG_VERBOSE };
+LogLevel logLevel = LOG_INFO;
+#define LOGI(...) do { if (logLevel >= LOG_INFO) printf(__VA_ARGS__); } while (0)
+#define LOGV(...) do { if (logLevel >= LOG_VERBOSE) printf(__VA_ARGS__); } while (0)
+
 std::unique_ptr<skgpu::graphite::Context> sGraphiteContext = nullptr;
 
+// Graphite pipelines from earlier runs on the same driver and device; written back when
+// the context is destroyed. Null with --no-pipeline-cache
+std::unique_ptr<perf::FilePipelineStorage> pipelineStorage;
+bool usePipelineCache = true;
+const char* pipelineCacheDir = nullptr;
+// draw the scene once offscreen before the first frame so its pipelines are ready
+bool pipelineWarmup = true;
+
+// span tracing, written as Chrome trace JSON on exit and when T is pressed. Null when off
+const char* traceFile = nullptr;
+
+void dumpTrace() {
+    long spans = perf::trace::writeChromeTrace(traceFile);
+    if (spans >= 0) {
+        LOGI("Wrote %ld spans to %s\n", spans, traceFile);
+    }
+}
+
+// startup metric: when the draw times stop showing compile hitches
+std::chrono::steady_clock::time_point appStart;
+perf::StableFrameDetector stableFrames;
+
 VkInstance instance;
 
 VkPhysicalDevice physicalDevice;
@@ -51,46 +112,107 @@ std::vector<VkImage> swapChainImages;
 
 std::vector<sk_sp<SkSurface>> skiaSwapChainSurfaces;
 
-VkSemaphore imageAvailableSemaphore, renderFinishedSemaphore;
-VkFence frameFence;
-
-double velocity[3] = {0, 0.02, 0.08}; // Different velocities for each circle
-double posY[3] = {1.0, 1.5, 3.7};
+// swapchain images to ask for, clamped to what the surface supports
+uint32_t requestedSwapchainImages = 3;
+
+// present mode to ask for, falls back to FIFO if the surface does not support it
+VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+// FIFO only: delay recording so the physics state is sampled as late as the frame budget allows
+bool lateLatching = false;
+// slack left between the latched recording start and the next expected acquire
+#define LATE_LATCH_MARGIN_US 1000
+std::chrono::steady_clock::time_point lastAcquire;
+double acquireIntervalUs = 0.0;
+
+// frames the CPU may record ahead of the GPU, each with its own fence and acquire semaphore
+uint32_t framesInFlight = 2;
+struct FrameSync
+{
+    VkSemaphore imageAvailable;
+    // signalled by the GPU timer's begin submit once the acquire is done, for Graphite to wait on
+    VkSemaphore timerStarted;
+    VkFence inFlight;
+};
+std::vector<FrameSync> frameSync;
+uint32_t currentFrame = 0;
+
+// per swapchain image: signalled when its rendering is done and waited on by its present
+std::vector<VkSemaphore> renderFinishedSemaphores;
+// per swapchain image: fence of the frame that last rendered into it
+std::vector<VkFence> imageFences;
+
+// The scene is rendered into one Graphite-owned overlay texture per frame in flight, which
+// the VR runtime copies from without an extra copy on our side; the window only shows a
+// mirror of it, so the presentation engine and the compositor never share an image.
+struct OverlayTarget
+{
+    skgpu::graphite::BackendTexture texture;
+    sk_sp<SkSurface> surface;
+    sim::OverlayImage image;
+    // damage tracker frame it holds, 0 before its first frame
+    uint64_t frame = 0;
+};
+std::vector<OverlayTarget> overlayTargets;
+// copy every overlay frame into the window; off with --no-mirror
+bool desktopMirror = true;
+// layouts Graphite leaves the images in at the end of a frame, both stay with the graphics queue
+// family: PRESENT_SRC for the mirror's swapchain image, TRANSFER_SRC for the VR runtime's copy
+skgpu::MutableTextureState presentState;
+skgpu::MutableTextureState overlayReleaseState;
+
+sim::BallStore balls;
+sim::WorldParams world;
 auto last_drawcall = std::chrono::high_resolution_clock::now();
 
 #define PERF_BUFFER_SIZE 512
 
-perf::PerfBuffer frameTimesDraw(PERF_BUFFER_SIZE);
-perf::PerfBuffer frameTimesPhysics(PERF_BUFFER_SIZE);
+// written by the render and physics threads, readable from any thread
+perf::SharedPerfBuffer frameTimesDraw(PERF_BUFFER_SIZE);
+perf::SharedPerfBuffer frameTimesPhysics(PERF_BUFFER_SIZE);
+// render thread: time from a returned acquire to the returned present of the same frame
+perf::SharedPerfBuffer frameLatency(PERF_BUFFER_SIZE);
+// render thread: time from the physics latch (after the late latch sleep) to the returned present;
+// with --record-threads, where a worker latched earlier, from the same point after the acquire
+perf::SharedPerfBuffer frameLatchLatency(PERF_BUFFER_SIZE);
+// pixels redrawn per frame, the full frame unless --partial-redraw
+perf::SharedPerfBuffer framePixels(PERF_BUFFER_SIZE);
+// C++ heap allocations (count and bytes) made for a frame on the threads that produced it;
+// what is left in steady state comes from Skia, e.g. the Recording objects of snap()
+perf::SharedPerfBuffer frameAllocations(PERF_BUFFER_SIZE);
+perf::SharedPerfBuffer frameAllocBytes(PERF_BUFFER_SIZE);
+
+void addAllocSample(const perf::AllocCounters& used) {
+    frameAllocations.addSample((uint32_t)std::min<uint64_t>(used.allocations, UINT32_MAX));
+    frameAllocBytes.addSample((uint32_t)std::min<uint64_t>(used.bytes, UINT32_MAX));
+}
 
-int meterToPixel(double meter) {
-    return static_cast<int>(meter * 100.0); // Assuming 1 meter = 100 pixels
+float meterToPixel(double meter) {
+    return static_cast<float>(meter * 100.0); // Assuming 1 meter = 100 pixels
 }
 
 double pixelToMeter(int pixel) {
     return static_cast<double>(pixel) / 100.0; // Assuming 1 meter = 100 pixels
 }
 
-std::optional<double> inline solve_quadratic(double a, double b, double c, double max_t) {
-    double disc = b * b - 4 * a * c;
-    if (disc < 0) {
-        return std::nullopt; // No real roots
-    }
-    double sqrt_d = std::sqrt(disc);
-    double denom = 2 * a;
-    double t1 = (-b - sqrt_d) / denom;
-    double t2 = (-b + sqrt_d) / denom;
-    double hit_t = std::numeric_limits<double>::infinity();
-    if (t1 > 0 && t1 <= max_t) hit_t = t1;
-    if (t2 > 0 && t2 <= max_t && t2 < hit_t) hit_t = t2;
-    if (hit_t == std::numeric_limits<double>::infinity()) {
-        return std::nullopt; // No valid positive roots in [0, max_t]
-    }
-    return hit_t;
-}
-
 vr::VROverlayHandle_t overlayHandle;
 
+// submits to the overlay made by InitVR()
+class OpenVROverlaySubmitter : public sim::OverlaySubmitter
+{
+    public:
+        bool submit(const vr::Texture_t& texture) override {
+            return vr::VROverlay()->SetOverlayTexture(overlayHandle, &texture) == vr::VROverlayError_None;
+        }
+};
+
+// --vr-stub runs without SteamVR and checks the submissions instead
+bool vrStub = false;
+// --validation loads the Khronos validation layer with synchronization validation
+bool vulkanValidation = false;
+OpenVROverlaySubmitter openVROverlay;
+sim::StubOverlaySubmitter stubOverlay;
+sim::OverlaySubmitter* overlaySubmitter = &openVROverlay;
+
 int InitVR() {
     vr::EVRInitError err;
     vr::IVRSystem* vrSystem;
@@ -117,76 +239,184 @@ int InitVR() {
     return 0;
 }
 
-auto last_physicsframe = std::chrono::high_resolution_clock::now();
-
-void physics() {
-    // Calculate time since last physics frame (delta time)
-    auto now = std::chrono::high_resolution_clock::now();
-    double dt = std::chrono::duration_cast<std::chrono::microseconds>(now - last_physicsframe).count() / 1000000.0;
-    last_physicsframe = now;
-
-    double floor = 5.0; // Floor at y = 5.0
-    // physics simulation
-    for (int c = 0; c < 3; ++c) {
-        double y = posY[c];
-        double v = velocity[c];
-        double a = 9.81;
-        double aa = 0.5 * a;
-        double ymax = floor - 0.5; // adjust bounce point by radius of the circle
-
-        // Check for collision within dt
-        double hit_t = std::numeric_limits<double>::infinity();
-
-        // Collision with bottom (y = ymax, so y(t) = y + v*t + aa*t^2 = ymax)
-        auto t_bottom = solve_quadratic(aa, v, y - ymax, dt);
-        if (t_bottom && *t_bottom < hit_t) hit_t = *t_bottom;
-
-        // Collision with top (y = 0.0, so y(t) = y + v*t + aa*t^2 = 0.0)
-        auto t_top = solve_quadratic(aa, v, y, dt);
-        if (t_top && *t_top < hit_t) hit_t = *t_top;
-
-        if (hit_t <= dt) {
-            // Collision detected: advance to hit time, bounce, then advance remaining time
-            double y_hit = y + v * hit_t + aa * hit_t * hit_t;
-            double v_hit = v + a * hit_t;
-            double v_new = -v_hit; // Elastic bounce
-            double t_rem = dt - hit_t;
-            posY[c] = y_hit + v_new * t_rem + aa * t_rem * t_rem;
-            velocity[c] = v_new + a * t_rem;
-        } else {
-            // No collision: standard parabolic update
-            posY[c] = y + v * dt + aa * dt * dt; // y(t) = y + v*t + 0.5*a*t^2
-            velocity[c] = v + a * dt; // v(t) = v + a*t
-        }
-    }
-
-    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - last_physicsframe).count();
-    frameTimesPhysics.addSample(elapsed);
+// physics runs on its own thread at a fixed rate and hands its state to draw()
+double physicsHz = 1000.0;
+size_t physicsThreads = std::thread::hardware_concurrency();
+bool ballCollisions = true;
+// fire wall impacts from a priority queue and sample positions once per period instead of stepping
+bool eventDriven = false;
+sim::TripleBuffer<sim::BallSnapshot> physicsState;
+
+// below this many balls a step is cheaper than waking the pool
+#define PHYSICS_PARALLEL_MIN_BALLS 16384
+#define PHYSICS_CHUNK_SIZE 4096
+
+// only touched by the thread that publishes
+uint64_t lastMoveTick = 0;
+
+void publishPhysicsState(const std::vector<double>& prevX, const std::vector<double>& prevY, std::chrono::steady_clock::time_point tickTime, double dt, uint64_t tick) {
+    sim::BallSnapshot& snap = physicsState.back();
+    bool moved = false;
+    for (size_t c = 0; c < balls.size(); ++c) {
+        snap.prevX[c] = (float)prevX[c];
+        snap.posX[c] = (float)balls.posX[c];
+        snap.prevY[c] = (float)prevY[c];
+        snap.posY[c] = (float)balls.posY[c];
+        snap.velY[c] = (float)balls.velY[c];
+        moved |= snap.prevX[c] != snap.posX[c] || snap.prevY[c] != snap.posY[c];
+    }
+    if (moved) {
+        lastMoveTick = tick;
+    }
+    snap.tickTime = tickTime;
+    snap.stepDt = dt;
+    snap.tick = tick;
+    snap.lastMoveTick = lastMoveTick;
+    physicsState.publish();
 }
 
-uint32_t inline map(uint32_t x, uint32_t in_min, uint32_t in_max, uint32_t out_min, uint32_t out_max) {
-    // Avoid division by zero
-    if (in_max == in_min) {
-        return out_min; // Return out_min as a safe default
+void physics(std::atomic<bool>& shouldRun) {
+    const double dt = 1.0 / physicsHz;
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(dt));
+    // when we fall further behind than this, drop the backlog instead of spiralling
+    const int maxCatchUpTicks = 8;
+
+    // the physics thread itself is one of the pool's participants
+    sim::WorkStealingPool pool(balls.size() >= PHYSICS_PARALLEL_MIN_BALLS ? physicsThreads : 1);
+
+    sim::BallCollider collider;
+    sim::EventSimulator events;
+    if (eventDriven) {
+        events.reset(balls, world);
+    }
+
+    std::vector<double> prevX(balls.size());
+    std::vector<double> prevY(balls.size());
+    uint64_t tick = 0;
+    auto nextTick = std::chrono::steady_clock::now() + period;
+    perf::trace::setThreadName("physics");
+
+    while (shouldRun) {
+        std::this_thread::sleep_until(nextTick);
+
+        auto now = std::chrono::steady_clock::now();
+        int ticksDue = 0;
+        if (eventDriven) {
+            // one closed-form sample covers all due ticks
+            TRACE_SCOPE("physics");
+            auto start = std::chrono::steady_clock::now();
+            while (nextTick <= now) {
+                tick++;
+                nextTick += period;
+            }
+            prevX = balls.posX;
+            prevY = balls.posY;
+            events.advanceTo(tick * dt);
+            events.sample(balls);
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            frameTimesPhysics.addSample(elapsed);
+        }
+        while (!eventDriven && nextTick <= now && ticksDue < maxCatchUpTicks) {
+            TRACE_SCOPE("physics");
+            auto start = std::chrono::steady_clock::now();
+            {
+                TRACE_SCOPE("step");
+                pool.parallelFor(0, balls.size(), PHYSICS_CHUNK_SIZE, [&](size_t begin, size_t end) {
+                    std::copy(balls.posX.begin() + begin, balls.posX.begin() + end, prevX.begin() + begin);
+                    std::copy(balls.posY.begin() + begin, balls.posY.begin() + end, prevY.begin() + begin);
+                    sim::step(balls, world, dt, begin, end);
+                });
+            }
+            if (ballCollisions) {
+                TRACE_SCOPE("collisions");
+                collider.resolve(balls, world, dt);
+            }
+            tick++;
+            ticksDue++;
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            frameTimesPhysics.addSample(elapsed);
+            nextTick += period;
+        }
+        if (nextTick <= now) {
+            nextTick = now + period;
+        }
+
+        TRACE_SCOPE("publish");
+        publishPhysicsState(prevX, prevY, nextTick - period, dt, tick);
     }
-    
-    // Compute using 64-bit arithmetic to prevent overflow
-    uint64_t numerator = (uint64_t)(x - in_min) * (out_max - out_min);
-    uint64_t denominator = in_max - in_min;
-    return out_min + (uint32_t)(numerator / denominator);
 }
 
-SkPaint ballPaint[3];
+// adaptive resolution: balls are drawn at a scale that holds this draw time in microseconds
+// into an offscreen surface and upscaled; 0 draws them at full size. The controller is fed
+// what scales with the pixel count: the GPU time per frame in the Vulkan path (the CPU
+// time to record and submit hardly depends on it), the CPU raster time in headless mode.
+uint32_t adaptiveTargetUs = 0;
+perf::ResolutionController resolution(0);
+// timestamps around every frame's work on the queue, only with --adaptive-resolution
+perf::GpuFrameTimer gpuTimer;
+// the controller's scale, set by the thread that times the frames and read by whichever records them
+std::atomic<float> renderScale = 1.0f;
+
+// draw all balls as one drawAtlas batch instead of one drawCircle each
+bool batchedBalls = false;
+
+// redraw only the tiles where this frame or the one in the target buffer has balls or the graph
+bool partialRedraw = false;
+
+// what drawScene() records with; the render thread has one, every record worker its own
+struct SceneContext
+{
+    sim::BallRenderer ballRenderer;
+    // perf graph over the shared buffers, only appends the new samples each frame
+    perf::PerfGraph perfGraph{SkRect::MakeXYWH(10, 10, PERF_BUFFER_SIZE, 75), PERF_BUFFER_SIZE};
+    // adaptive resolution only
+    sk_sp<SkSurface> offscreenSurface;
+    sim::DamageTracker damage{RENDER_WIDTH, RENDER_HEIGHT};
+};
+SceneContext mainScene;
+
+SkPaint ballPaint;
 SkPaint whitePerfBoxPaint;
 SkPaint greenPerfGraphPaint;
 SkPaint magentaPerfGraphPaint;
+SkPaint greenP99Paint;
+SkPaint magentaP99Paint;
+SkPaint yellowPerfGraphPaint;
+SkPaint yellowP99Paint;
+
+void initializeBalls(size_t count) {
+    balls.resize(count);
+    if (count == 3) {
+        // the original three circles
+        const double velocity[3] = {0, 0.02, 0.08}; // Different velocities for each circle
+        const double posY[3] = {1.0, 1.5, 3.7};
+        for (size_t c = 0; c < 3; ++c) {
+            balls.posX[c] = 1 + c * 1.5;
+            balls.posY[c] = posY[c];
+            balls.velY[c] = velocity[c];
+        }
+        return;
+    }
 
-void initializePaints() {
-    for (int c = 0; c < 3; ++c) {
-        ballPaint[c].setColor({0.0f, 0.0f, 0.35f, 1.0f}); // Default color
-        ballPaint[c].setAntiAlias(true);
-        ballPaint[c].setStyle(SkPaint::kFill_Style);
+    // stress scene: small balls spread over the window, sized to cover ~15% of it
+    double area = (world.right - world.left) * (world.floor - world.top);
+    world.radius = std::min(0.05, std::sqrt(0.15 * area / (count * M_PI)));
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> x(world.left + world.radius, world.right - world.radius);
+    std::uniform_real_distribution<double> y(world.top + world.radius, world.floor - world.radius);
+    std::uniform_real_distribution<double> v(-3.0, 3.0);
+    for (size_t c = 0; c < count; ++c) {
+        balls.posX[c] = x(rng);
+        balls.posY[c] = y(rng);
+        balls.velX[c] = v(rng);
+        balls.velY[c] = v(rng);
     }
+}
+
+void initializePaints() {
+    ballPaint.setColor({0.0f, 0.0f, 0.35f, 1.0f}); // Default color
+    ballPaint.setAntiAlias(true);
+    ballPaint.setStyle(SkPaint::kFill_Style);
 
     whitePerfBoxPaint.setColor(SK_ColorWHITE);
     whitePerfBoxPaint.setStyle(SkPaint::kStroke_Style);
@@ -199,141 +429,835 @@ void initializePaints() {
     magentaPerfGraphPaint.setColor(SK_ColorMAGENTA);
     magentaPerfGraphPaint.setStyle(SkPaint::kStroke_Style);
     magentaPerfGraphPaint.setStrokeWidth(1);
+
+    greenP99Paint.setColor(SkColorSetARGB(128, 0, 255, 0));
+    greenP99Paint.setStyle(SkPaint::kStroke_Style);
+    greenP99Paint.setStrokeWidth(1);
+
+    magentaP99Paint.setColor(SkColorSetARGB(128, 255, 0, 255));
+    magentaP99Paint.setStyle(SkPaint::kStroke_Style);
+    magentaP99Paint.setStrokeWidth(1);
+
+    yellowPerfGraphPaint.setColor(SK_ColorYELLOW);
+    yellowPerfGraphPaint.setStyle(SkPaint::kStroke_Style);
+    yellowPerfGraphPaint.setStrokeWidth(1);
+
+    yellowP99Paint.setColor(SkColorSetARGB(128, 255, 255, 0));
+    yellowP99Paint.setStyle(SkPaint::kStroke_Style);
+    yellowP99Paint.setStrokeWidth(1);
 }
 
-void draw() {
-    if (vkGetFenceStatus(device, frameFence) != VK_SUCCESS) {
-        vkWaitForFences(device, 1, &frameFence, VK_TRUE, UINT64_MAX);
+// Ball sprite, offscreen surface and graph series of one scene. Graphite resources are
+// made with recorder and can only be drawn by it; without one everything is raster.
+bool initializeScene(SceneContext& scene, skgpu::graphite::Recorder* recorder) {
+    if (!scene.ballRenderer.prepare(meterToPixel(world.radius), recorder)) {
+        fprintf(stderr, "Failed to create the ball sprite\n");
+        return false;
     }
-    vkResetFences(device, 1, &frameFence);
-
-    uint32_t imageIndex;
-    VkResult acquire_result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-    if (acquire_result != VK_SUCCESS && acquire_result != VK_SUBOPTIMAL_KHR) {
-        printf("Failed to acquire swapchain image: %d\n", acquire_result);
-        return;
+    if (adaptiveTargetUs > 0) {
+        // full size once, lower scales only use its top left part
+        SkImageInfo offscreenInfo = SkImageInfo::Make(RENDER_WIDTH, RENDER_HEIGHT, kRGBA_8888_SkColorType, kPremul_SkAlphaType, SkColorSpace::MakeSRGB());
+        scene.offscreenSurface = recorder ? SkSurfaces::RenderTarget(recorder, offscreenInfo)
+                                          : SkSurfaces::Raster(SkImageInfo::MakeN32Premul(RENDER_WIDTH, RENDER_HEIGHT));
+        if (!scene.offscreenSurface) {
+            fprintf(stderr, "Failed to create the offscreen surface\n");
+            return false;
+        }
     }
+    scene.perfGraph.addSeries(&frameTimesDraw, greenPerfGraphPaint, greenP99Paint);
+    scene.perfGraph.addSeries(&frameTimesPhysics, magentaPerfGraphPaint, magentaP99Paint);
+    scene.perfGraph.addSeries(&frameLatency, yellowPerfGraphPaint, yellowP99Paint);
+    return true;
+}
 
-    auto start = std::chrono::high_resolution_clock::now();
+void drawBalls(SceneContext& scene, SkCanvas* canvas, const sim::BallSnapshot& snap, float alpha) {
+    if (batchedBalls) {
+        scene.ballRenderer.draw(canvas, snap, alpha, meterToPixel);
+    }
+    else {
+        // draw circles with different colors based on velocity
+        SkPaint paint = ballPaint;
+        for(size_t c = 0; c < snap.size(); ++c) {
+            float scaledVelocity = std::abs(snap.velY[c] / 15.0f);
+            paint.setColor({std::clamp(scaledVelocity, 0.0f, 1.0f), 0.0f, 0.35f, 1.0f});
+
+            float x = snap.prevX[c] + (snap.posX[c] - snap.prevX[c]) * alpha;
+            float y = snap.prevY[c] + (snap.posY[c] - snap.prevY[c]) * alpha;
+            canvas->drawCircle(meterToPixel(x), meterToPixel(y), meterToPixel(world.radius), paint);
+        }
+    }
+}
 
-    sk_sp<SkSurface> activeSurface = skiaSwapChainSurfaces[imageIndex];
+// marks the tiles covered by the balls and the perf graph in a new damage frame
+uint64_t trackDamage(SceneContext& scene, const sim::BallSnapshot& snap, float alpha) {
+    sim::DamageTracker& damage = scene.damage;
+    uint64_t frame = damage.beginFrame();
+    float radius = meterToPixel(world.radius) + 1.0f; // AA fringe
+    for (size_t c = 0; c < snap.size(); ++c) {
+        float x = meterToPixel(snap.prevX[c] + (snap.posX[c] - snap.prevX[c]) * alpha);
+        float y = meterToPixel(snap.prevY[c] + (snap.posY[c] - snap.prevY[c]) * alpha);
+        damage.add(x - radius, y - radius, x + radius, y + radius);
+        if (damage.coversAll()) {
+            // dense scenes: everything is redrawn anyway, skip the remaining balls
+            break;
+        }
+    }
+    // the box stroke is 2 px wide and centered on the bounds
+    damage.add(scene.perfGraph.getBounds().makeOutset(2, 2));
+    return frame;
+}
 
-    auto recorder = activeSurface->recorder();
-    
-    SkCanvas* canvas = activeSurface->getCanvas();
+// Draws the balls and the perf graph. Shared by the Vulkan path, the record workers and headless mode.
+// targetFrame is the damage frame the target holds; with --partial-redraw only what differs from
+// it is cleared and drawn, and it is set to the frame drawn now. Returns the pixels redrawn.
+size_t drawScene(SceneContext& scene, SkCanvas* canvas, const sim::BallSnapshot& snap, float alpha, uint64_t& targetFrame) {
+    size_t pixels = RENDER_WIDTH * RENDER_HEIGHT;
+    canvas->save();
+    if (partialRedraw) {
+        uint64_t frame = trackDamage(scene, snap, alpha);
+        const SkRegion& region = scene.damage.damage(targetFrame);
+        if (!scene.damage.isFull()) {
+            // the clear becomes a scissored one, draws outside the region are rejected
+            canvas->clipRegion(region);
+        }
+        pixels = scene.damage.getPixels();
+        targetFrame = frame;
+    }
     canvas->clear(SK_ColorBLACK);
 
-    // draw circles with different colors based on velocity
-    for(int c = 0; c < 3; ++c) {
-        float scaledVelocity = std::abs(velocity[c] / 15.0f);
-        ballPaint[c].setColor({std::clamp(scaledVelocity, 0.0f, 1.0f), 0.0f, 0.35f, 1.0f});
-
-        canvas->drawCircle(meterToPixel(1 + c * 1.5), meterToPixel(posY[c]), meterToPixel(0.5), ballPaint[c]); // Draw a circle at (100 + c * 150, posY[c]) with radius 50
+    if (scene.offscreenSurface) {
+        // balls at the controller's scale into the top left of the offscreen surface, then
+        // upscaled; the perf graph stays at full resolution
+        float scale = renderScale.load(std::memory_order_relaxed);
+        SkRect src = SkRect::MakeWH(RENDER_WIDTH * scale, RENDER_HEIGHT * scale);
+        SkCanvas* offscreen = scene.offscreenSurface->getCanvas();
+        offscreen->save();
+        offscreen->clipRect(src);
+        offscreen->clear(SK_ColorBLACK);
+        offscreen->scale(scale, scale);
+        drawBalls(scene, offscreen, snap, alpha);
+        offscreen->restore();
+
+        // Graphite can sample the surface's texture directly, raster takes a copy-on-write snapshot
+        sk_sp<SkImage> image = scene.offscreenSurface->recorder() ? SkSurfaces::AsImage(scene.offscreenSurface) : scene.offscreenSurface->makeImageSnapshot();
+        canvas->drawImageRect(image, src, SkRect::MakeWH(RENDER_WIDTH, RENDER_HEIGHT),
+                              SkSamplingOptions(SkFilterMode::kLinear), nullptr, SkCanvas::kFast_SrcRectConstraint);
+    }
+    else {
+        drawBalls(scene, canvas, snap, alpha);
     }
 
     // PERF GRAPH
-    if(true) {
-        int perfGraphHeight = 75;
-        int perfGraphWidth = PERF_BUFFER_SIZE;
-        // draw box
-        canvas->drawRect(SkRect::MakeXYWH(10, 10, perfGraphWidth, perfGraphHeight), whitePerfBoxPaint);
+    scene.perfGraph.update();
+    scene.perfGraph.draw(canvas, whitePerfBoxPaint);
+    canvas->restore();
+    return pixels;
+}
+
+// --capture: the drawn frames as serialized SkPictures in a capture file, for capture_replay
+const char* captureFile = nullptr;
+size_t captureFrames = 300;
+perf::CaptureWriter capture;
+
+// images in captured pictures are stored as PNG; the ball sprite is a texture, its raster original goes in instead
+sk_sp<SkData> serializeCapturedImage(SkImage* image, void* ctx) {
+    const sim::BallRenderer* renderer = static_cast<const sim::BallRenderer*>(ctx);
+    if (renderer->isSprite(image)) {
+        image = renderer->getRasterSprite().get();
+    }
+    return image->isTextureBacked() ? nullptr : SkPngEncoder::Encode(nullptr, image, {});
+}
 
-        SkPath drawPath;
-        for (int c = 0; c < PERF_BUFFER_SIZE; ++c) {
-            auto yFt = map(frameTimesDraw.getOrderedSample(c), frameTimesDraw.getMin(), frameTimesDraw.getMax(), 0, perfGraphHeight);
-            SkPoint point = SkPoint::Make(c + 10, 75 - yFt + 10);
-            c == 0 ? drawPath.moveTo(point) : drawPath.lineTo(point);
+// drawScene() into a picture recorder and the picture into canvas, so the frame's commands can be captured
+size_t drawSceneCaptured(SceneContext& scene, SkCanvas* canvas, const sim::BallSnapshot& snap, float alpha, uint64_t& targetFrame, sk_sp<SkPicture>& picture) {
+    SkPictureRecorder pictureRecorder;
+    size_t pixels = drawScene(scene, pictureRecorder.beginRecording(SkRect::MakeWH(RENDER_WIDTH, RENDER_HEIGHT)), snap, alpha, targetFrame);
+    picture = pictureRecorder.finishRecordingAsPicture();
+    canvas->drawPicture(picture);
+    return pixels;
+}
+
+void closeCapture() {
+    if (capture.isOpen()) {
+        LOGI("Captured %llu frames (%.1f MB) to %s\n", (unsigned long long)capture.getFrameCount(), capture.getBytes() / 1e6, captureFile);
+        capture.close();
+    }
+}
+
+// after the frame's draw time is known; serializing is not part of it
+void captureFrame(SceneContext& scene, const SkPicture* picture, uint64_t frame, uint32_t drawUs) {
+    TRACE_SCOPE("capture");
+    SkSerialProcs procs;
+    procs.fImageProc = serializeCapturedImage;
+    procs.fImageCtx = &scene.ballRenderer;
+    sk_sp<SkData> data = picture->serialize(&procs);
+    if (!data || !capture.append(data->data(), data->size(), frame, drawUs) || capture.isFull()) {
+        closeCapture();
+    }
+}
+
+// --record-threads: workers record whole frames, each with its own Recorder, while the
+// render thread inserts and submits the ones before; 0 records on the render thread
+size_t recordThreads = 0;
+// finished recordings a worker may hold before it waits for the render thread
+#define RECORD_QUEUE_DEPTH 1
+
+struct RecordWorker
+{
+    std::unique_ptr<skgpu::graphite::Recorder> recorder;
+    SceneContext scene;
+    // physics state latched for the frame being recorded
+    sim::BallSnapshot snap;
+    float alpha = 1.0f;
+};
+
+struct RecordedFrame
+{
+    std::unique_ptr<skgpu::graphite::Recording> recording;
+    uint32_t recordUs = 0;
+    // allocations on the worker, added to the frame's
+    perf::AllocCounters allocs;
+};
+
+std::vector<std::unique_ptr<RecordWorker>> recordWorkers;
+std::unique_ptr<sim::OrderedPipeline<RecordedFrame>> recordPipeline;
+// recordings are made for a deferred canvas with the overlay textures' format and bound to
+// the frame's overlay texture on insert
+skgpu::graphite::TextureInfo overlayTextureInfo;
+
+// runs in frame order, so the workers never hand out an older physics state after a newer one
+void latchFrame(size_t w, uint64_t) {
+    RecordWorker& worker = *recordWorkers[w];
+    worker.snap = physicsState.acquire();
+    worker.alpha = worker.snap.interpolationAlpha(std::chrono::steady_clock::now());
+}
+
+RecordedFrame recordFrame(size_t w, uint64_t) {
+    TRACE_SCOPE("record");
+    RecordWorker& worker = *recordWorkers[w];
+    auto start = std::chrono::steady_clock::now();
+    perf::AllocCounters allocStart = perf::threadAllocCounters();
+
+    // the target image is only known on insert, so workers always redraw in full
+    uint64_t targetFrame = 0;
+    SkImageInfo info = SkImageInfo::Make(RENDER_WIDTH, RENDER_HEIGHT, kRGBA_8888_SkColorType, kPremul_SkAlphaType, SkColorSpace::MakeSRGB());
+    drawScene(worker.scene, worker.recorder->makeDeferredCanvas(info, overlayTextureInfo), worker.snap, worker.alpha, targetFrame);
+
+    RecordedFrame frame;
+    frame.recording = worker.recorder->snap();
+    frame.recordUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    frame.allocs = perf::threadAllocCounters() - allocStart;
+    return frame;
+}
+
+// presented frames (submitted to the overlay without the mirror), for the throughput printed on exit
+uint64_t presentedFrames = 0;
+
+// paces the render thread: vsync (the blocking acquire), fixed at targetHz, or on demand
+sim::FrameScheduler::Mode pacingMode = sim::FrameScheduler::VSYNC;
+double targetHz = 90.0;
+sim::FrameScheduler scheduler;
+
+// on-demand pacing: the HUD graphs get new samples all the time, redraw them at most this often
+#define ON_DEMAND_HUD_HZ 4
+// render thread: what the last drawn frame showed
+uint64_t drawnTick = 0;
+uint64_t drawnPhysicsSamples = 0;
+std::chrono::steady_clock::time_point lastHudFrame;
+
+// on-demand pacing: a frame is due when a ball moved after the last drawn tick, or the graph
+// has new samples and the last HUD refresh is long enough ago
+bool sceneChanged() {
+    const sim::BallSnapshot& snap = physicsState.acquire();
+    if (snap.lastMoveTick > drawnTick) {
+        return true;
+    }
+    auto now = std::chrono::steady_clock::now();
+    return frameTimesPhysics.getSampleCount() != drawnPhysicsSamples && now - lastHudFrame >= std::chrono::milliseconds(1000 / ON_DEMAND_HUD_HZ);
+}
+
+// --metrics-shm: the perf series and frame counters in shared memory, for metrics_cli
+const char* metricsShmName = nullptr;
+perf::MetricsWriter metricsShm;
+
+bool openMetricsShm() {
+    metricsShm.addSeries("draw", "us", &frameTimesDraw);
+    metricsShm.addSeries("physics", "ns", &frameTimesPhysics);
+    metricsShm.addSeries("latency", "us", &frameLatency);
+    metricsShm.addSeries("pixels", "px", &framePixels);
+    metricsShm.addSeries("allocs", "n", &frameAllocations);
+    metricsShm.addSeries("alloc bytes", "B", &frameAllocBytes);
+    return metricsShm.open(metricsShmName);
+}
+
+// render thread (or headless), once per frame; costs about a microsecond and never waits for readers
+void publishMetrics(uint64_t frames, uint64_t presented, const sim::FrameScheduler::Stats* pacing) {
+    perf::MetricsCounters counters;
+    counters.frames = frames;
+    counters.presented = presented;
+    counters.missed = pacing ? pacing->missed : 0;
+    counters.skipped = pacing ? pacing->skipped : 0;
+    counters.balls = balls.size();
+    metricsShm.publish(counters);
+}
+
+void draw() {
+    TRACE_SCOPE("frame");
+    perf::AllocCounters allocStart = perf::threadAllocCounters();
+
+    // only waits for the frame that used this slot framesInFlight frames ago
+    FrameSync& frame = frameSync[currentFrame];
+    if (vkGetFenceStatus(device, frame.inFlight) != VK_SUCCESS) {
+        TRACE_SCOPE("fence wait");
+        vkWaitForFences(device, 1, &frame.inFlight, VK_TRUE, UINT64_MAX);
+    }
+
+    // the GPU time of the frame this slot held before, framesInFlight frames ago; a scale
+    // change shows up that much later, which the controller's 60 frame window absorbs
+    uint32_t gpuUs = 0;
+    if (gpuTimer.isOpen() && gpuTimer.read(currentFrame, gpuUs)) {
+        resolution.addSample(gpuUs);
+        renderScale.store(resolution.getScale(), std::memory_order_relaxed);
+    }
+
+    // pipelined: take the next recording before acquiring, so no image is held while a worker finishes
+    RecordedFrame recorded;
+    if (recordPipeline) {
+        TRACE_SCOPE("wait for recording");
+        if (!recordPipeline->next(recorded)) {
+            return;
+        }
+    }
+
+    uint32_t imageIndex = 0;
+    if (desktopMirror) {
+        VkResult acquire_result;
+        {
+            TRACE_SCOPE("acquire");
+            acquire_result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
+        }
+        if (acquire_result != VK_SUCCESS && acquire_result != VK_SUBOPTIMAL_KHR) {
+            printf("Failed to acquire swapchain image: %d\n", acquire_result);
+            return;
         }
-        canvas->drawPath(drawPath, greenPerfGraphPaint);
 
-        // Draw second polyline (magenta)
-        SkPath physicsPath;
-        for (int c = 0; c < PERF_BUFFER_SIZE; ++c) {
-            auto yPhy = map(frameTimesPhysics.getOrderedSample(c), frameTimesPhysics.getMin(), frameTimesPhysics.getMax(), 0, perfGraphHeight);
-            SkPoint point = SkPoint::Make(c + 10, 75 - yPhy + 10);
-            c == 0 ? physicsPath.moveTo(point) : physicsPath.lineTo(point);
+        // with more frames in flight than images, an older frame may still render into this image
+        if (imageFences[imageIndex] != VK_NULL_HANDLE && imageFences[imageIndex] != frame.inFlight) {
+            TRACE_SCOPE("image fence wait");
+            vkWaitForFences(device, 1, &imageFences[imageIndex], VK_TRUE, UINT64_MAX);
+        }
+        imageFences[imageIndex] = frame.inFlight;
+    }
+    // reset only once the frame is certain to submit, so a failed acquire cannot leave it unsignalled
+    vkResetFences(device, 1, &frame.inFlight);
+
+    // under FIFO a blocking acquire returns once per refresh, so its spacing is the refresh interval
+    auto acquired = std::chrono::steady_clock::now();
+    if (lastAcquire.time_since_epoch().count() != 0) {
+        double intervalUs = std::chrono::duration<double, std::micro>(acquired - lastAcquire).count();
+        acquireIntervalUs = acquireIntervalUs == 0.0 ? intervalUs : acquireIntervalUs + (intervalUs - acquireIntervalUs) / 16.0;
+    }
+    lastAcquire = acquired;
+
+    // late latching: start recording one p99 draw time (plus margin) before the next refresh
+    if (lateLatching && acquireIntervalUs > 0.0) {
+        double budgetUs = frameTimesDraw.getStats().p99 + LATE_LATCH_MARGIN_US;
+        if (budgetUs < acquireIntervalUs) {
+            TRACE_SCOPE("late latch");
+            std::this_thread::sleep_until(acquired + std::chrono::microseconds((int64_t)(acquireIntervalUs - budgetUs)));
         }
-        canvas->drawPath(physicsPath, magentaPerfGraphPaint);
     }
 
-    // get the drawing commands from the recorder and insert them into the Graphite context
-    // std::unique_ptr<skgpu::graphite::Recording> recording = ;
+    auto start = std::chrono::high_resolution_clock::now();
+    auto latched = std::chrono::steady_clock::now();
+
+    // this slot's fence was submitted after the VR runtime queued its copy of the overlay
+    // texture (end of draw()), so the GPU and the copy are both done with the texture
+    OverlayTarget& overlay = overlayTargets[currentFrame];
+
+    size_t pixels = RENDER_WIDTH * RENDER_HEIGHT;
+    sk_sp<SkPicture> picture;
+    if (!recordPipeline) {
+        auto recorder = overlay.surface->recorder();
+
+        SkCanvas* canvas = overlay.surface->getCanvas();
+
+        // newest physics tick, drawn one tick behind and interpolated to now
+        const sim::BallSnapshot& snap = physicsState.acquire();
+        float alpha = snap.interpolationAlpha(std::chrono::steady_clock::now());
+        drawnTick = snap.tick;
+        drawnPhysicsSamples = frameTimesPhysics.getSampleCount();
+        lastHudFrame = std::chrono::steady_clock::now();
+        {
+            TRACE_SCOPE("record");
+            pixels = capture.isOpen() ? drawSceneCaptured(mainScene, canvas, snap, alpha, overlay.frame, picture)
+                                      : drawScene(mainScene, canvas, snap, alpha, overlay.frame);
+        }
 
-    sGraphiteContext->insertRecording({
-        .fRecording = recorder->snap().get(),
-        .fTargetSurface = activeSurface.get()
-    });
+        // get the drawing commands from the recorder
+        TRACE_SCOPE("snap");
+        recorded.recording = recorder->snap();
+    }
 
-    // Submit the drawing commands
-    sGraphiteContext->submit();
+    // insert them into the Graphite context; a deferred recording gets the overlay texture as its target
+    {
+        TRACE_SCOPE("insertRecording");
+        sGraphiteContext->insertRecording({
+            .fRecording = recorded.recording.get(),
+            .fTargetSurface = overlay.surface.get()
+        });
+    }
 
-    // notifiy semaphore after skia has finished drawing
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    VkSubmitInfo submitInfo{
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext = nullptr,
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &imageAvailableSemaphore,
-        .pWaitDstStageMask = waitStages,
-        .commandBufferCount = 0, // Skia manages command buffers internally
-        .pCommandBuffers = nullptr,
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &renderFinishedSemaphore
-    };
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, frameFence);
-
-
-    /*
-    uint64_t m_nImage; // VkImage
-	VkDevice_T *m_pDevice;
-	VkPhysicalDevice_T *m_pPhysicalDevice;
-	VkInstance_T *m_pInstance;
-	VkQueue_T *m_pQueue;
-	uint32_t m_nQueueFamilyIndex;
-	uint32_t m_nWidth, m_nHeight, m_nFormat, m_nSampleCount;
-    */
-
-    vr::VRVulkanTextureData_t vulkanTextureData = {
-        .m_nImage = (uint64_t)(swapChainImages[imageIndex]),
-        .m_pDevice = device,
-        .m_pPhysicalDevice = physicalDevice,
-        .m_pInstance = instance,
-        .m_pQueue = graphicsQueue,
-        .m_nQueueFamilyIndex = (uint32_t)graphicsQueueFamilyIndex,
-        .m_nWidth = 640, // Assuming 1920x1080 resolution
-        .m_nHeight = 480,
-        .m_nFormat = VK_FORMAT_R8G8B8A8_UNORM,
-        .m_nSampleCount = 1 // No multisampling
-    };
+    // the GPU timer's begin timestamp goes ahead of Graphite's submit; with the mirror it takes over
+    // the acquire wait and passes it on, so the time the GPU waits for the image is not counted
+    bool gpuTimed = gpuTimer.isOpen() && gpuTimer.begin(graphicsQueue, currentFrame,
+                                                        desktopMirror ? frame.imageAvailable : VK_NULL_HANDLE,
+                                                        desktopMirror ? frame.timerStarted : VK_NULL_HANDLE);
+
+    // the mirror samples the overlay texture into the swapchain image and leaves it ready to present;
+    // Graphite's submit waits for the acquire before it writes the image and signals the present
+    sk_sp<SkSurface> activeSurface = desktopMirror ? skiaSwapChainSurfaces[imageIndex] : nullptr;
+    if (activeSurface) {
+        TRACE_SCOPE("mirror");
+        activeSurface->getCanvas()->drawImage(SkSurfaces::AsImage(overlay.surface), 0, 0);
+        std::unique_ptr<skgpu::graphite::Recording> mirror = activeSurface->recorder()->snap();
+        skgpu::graphite::BackendSemaphore waitSemaphore = skgpu::graphite::BackendSemaphores::MakeVulkan(gpuTimed ? frame.timerStarted : frame.imageAvailable);
+        skgpu::graphite::BackendSemaphore signalSemaphore = skgpu::graphite::BackendSemaphores::MakeVulkan(renderFinishedSemaphores[imageIndex]);
+        sGraphiteContext->insertRecording({
+            .fRecording = mirror.get(),
+            .fTargetSurface = activeSurface.get(),
+            .fTargetTextureState = &presentState,
+            .fNumWaitSemaphores = 1,
+            .fWaitSemaphores = &waitSemaphore,
+            .fNumSignalSemaphores = 1,
+            .fSignalSemaphores = &signalSemaphore
+        });
+    }
+
+    // hand the overlay texture over in the layout the VR runtime copies from; after the mirror,
+    // which samples it, so an empty recording carries the transition
+    {
+        TRACE_SCOPE("overlay release");
+        std::unique_ptr<skgpu::graphite::Recording> release = overlay.surface->recorder()->snap();
+        sGraphiteContext->insertRecording({
+            .fRecording = release.get(),
+            .fTargetSurface = overlay.surface.get(),
+            .fTargetTextureState = &overlayReleaseState
+        });
+    }
+
+    // Submit the drawing commands, between the GPU timer's two timestamps
+    {
+        TRACE_SCOPE("submit");
+        sGraphiteContext->submit();
+    }
 
-    vr::Texture_t swapChainTexture = {
-        .handle = &vulkanTextureData,
-        .eType = vr::TextureType_Vulkan,
-        .eColorSpace = vr::ColorSpace_Gamma
-    };    
+    // the GPU timer's end timestamp in a batch of its own, with no wait that could hold it back;
+    // the slot's fence comes after the overlay submit
+    if (gpuTimed) {
+        VkSubmitInfo submitInfo{
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = gpuTimer.getEndCommandBuffer(currentFrame)
+        };
+        TRACE_SCOPE("vkQueueSubmit");
+        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    }
 
+    // pipelined frames count the worker's recording time plus the insert and submit here
     auto stop = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+    auto duration = recorded.recordUs + std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
     frameTimesDraw.addSample(duration);
+    framePixels.addSample(pixels);
+    if (!gpuTimer.isOpen()) {
+        resolution.addSample(duration);
+        renderScale.store(resolution.getScale(), std::memory_order_relaxed);
+    }
+    if (!stableFrames.isStable()) {
+        double sinceStartMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - appStart).count();
+        if (stableFrames.addFrame(duration, sinceStartMs)) {
+            LOGI("First stable frame #%llu at %.1f ms after start (confirmed at %.1f ms)\n",
+                 (unsigned long long)stableFrames.getStableFrame(), stableFrames.getStableFrameTime(), sinceStartMs);
+        }
+    }
 
     // Present the swapchain image
-    VkPresentInfoKHR presentInfo{};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.waitSemaphoreCount = 1; // No semaphores to wait on
-    presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = &swapChain;
-    presentInfo.pImageIndices = &imageIndex; // Use the first image
-    presentInfo.pResults = nullptr; // No results to return
-    VkResult result = vkQueuePresentKHR(graphicsQueue, &presentInfo);
-    if (result != VK_SUCCESS) {
-        fprintf(stderr, "Failed to present swapchain image: %d\n", result);
-    }
-
-    vr::VROverlay()->SetOverlayTexture(overlayHandle, &swapChainTexture);
+    bool presented = true;
+    if (desktopMirror) {
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &renderFinishedSemaphores[imageIndex];
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &swapChain;
+        presentInfo.pImageIndices = &imageIndex;
+        presentInfo.pResults = nullptr; // No results to return
+        VkResult result;
+        {
+            TRACE_SCOPE("present");
+            result = vkQueuePresentKHR(graphicsQueue, &presentInfo);
+        }
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "Failed to present swapchain image: %d\n", result);
+            presented = false;
+        }
+    }
+
+    auto presentReturned = std::chrono::steady_clock::now();
+    frameLatency.addSample(std::chrono::duration_cast<std::chrono::microseconds>(presentReturned - acquired).count());
+    frameLatchLatency.addSample(std::chrono::duration_cast<std::chrono::microseconds>(presentReturned - latched).count());
+
+    // the runtime queues its copy of the texture on our queue, behind the submit above
+    {
+        TRACE_SCOPE("SetOverlayTexture");
+        vr::VRVulkanTextureData_t vulkanData;
+        presented = overlaySubmitter->submit(sim::makeOverlayTexture(overlay.image, vulkanData)) && presented;
+    }
+    // the slot's fence signals once everything queued so far has run, the runtime's copy
+    // included, so the texture is not rendered to again while the copy still reads it
+    {
+        TRACE_SCOPE("fence submit");
+        vkQueueSubmit(graphicsQueue, 0, nullptr, frame.inFlight);
+    }
+    if (presented) {
+        presentedFrames++;
+    }
+    addAllocSample(perf::threadAllocCounters() - allocStart + recorded.allocs);
+    // serializing is not part of the frame; numbered from 0 like --headless, dropped frames included
+    if (picture) {
+        captureFrame(mainScene, picture.get(), scheduler.getFrameCount() - 1, duration);
+    }
+
+    currentFrame = (currentFrame + 1) % framesInFlight;
 }
 
-int main() {
+// Runs the scene and the perf graph into a CPU raster surface, no window, Vulkan or
+// OpenVR. Physics is stepped in lockstep with a fixed 90 Hz frame clock so the output
+// is reproducible, e.g. for golden image checks via pngDir. With --event-driven the
+// event engine is advanced to each frame's time and sampled once instead.
+int runHeadless(size_t frameCount, const char* pngDir) {
+    const int width = RENDER_WIDTH;
+    const int height = RENDER_HEIGHT;
+    const double frameDt = 1.0 / 90.0;
+    const int ticksPerFrame = std::max(1, (int)std::lround(physicsHz * frameDt));
+    const double dt = frameDt / ticksPerFrame;
+
+    sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(width, height));
+    if (!surface) {
+        fprintf(stderr, "Failed to create raster surface\n");
+        return -1;
+    }
+
+    sim::BallCollider collider;
+    sim::EventSimulator events;
+    if (eventDriven) {
+        events.reset(balls, world);
+    }
+    std::vector<double> prevX(balls.size());
+    std::vector<double> prevY(balls.size());
+
+    // per-phase timings in microseconds over the whole run
+    perf::PerfBuffer physicsTimes(frameCount);
+    perf::PerfBuffer drawTimes(frameCount);
+    perf::PerfBuffer encodeTimes(frameCount);
+    perf::PerfBuffer redrawnPixels(frameCount);
+    perf::PerfBuffer allocations(frameCount);
+    perf::PerfBuffer allocBytes(frameCount);
+    // the one surface keeps its content, so with --partial-redraw every frame after the first is partial
+    uint64_t surfaceFrame = 0;
+
+    sk_sp<SkPicture> picture;
+
+    perf::trace::setThreadName("headless");
+    auto runStart = std::chrono::steady_clock::now();
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        TRACE_SCOPE("frame");
+        auto start = std::chrono::steady_clock::now();
+        perf::AllocCounters allocStart = perf::threadAllocCounters();
+        if (eventDriven) {
+            TRACE_SCOPE("physics");
+            prevX = balls.posX;
+            prevY = balls.posY;
+            events.advanceTo((frame + 1) * ticksPerFrame * dt);
+            events.sample(balls);
+        }
+        for (int t = 0; !eventDriven && t < ticksPerFrame; ++t) {
+            TRACE_SCOPE("physics");
+            prevX = balls.posX;
+            prevY = balls.posY;
+            sim::step(balls, world, dt);
+            if (ballCollisions) {
+                collider.resolve(balls, world, dt);
+            }
+        }
+        publishPhysicsState(prevX, prevY, start, dt, (frame + 1) * ticksPerFrame);
+        auto physicsDone = std::chrono::steady_clock::now();
+        frameTimesPhysics.addSample(std::chrono::duration_cast<std::chrono::nanoseconds>(physicsDone - start).count());
+
+        {
+            TRACE_SCOPE("draw");
+            redrawnPixels.addSample(capture.isOpen() ? drawSceneCaptured(mainScene, surface->getCanvas(), physicsState.acquire(), 1.0f, surfaceFrame, picture)
+                                                     : drawScene(mainScene, surface->getCanvas(), physicsState.acquire(), 1.0f, surfaceFrame));
+        }
+        auto drawDone = std::chrono::steady_clock::now();
+        frameTimesDraw.addSample(std::chrono::duration_cast<std::chrono::microseconds>(drawDone - physicsDone).count());
+        perf::AllocCounters allocs = perf::threadAllocCounters() - allocStart;
+        addAllocSample(allocs);
+        allocations.addSample((uint32_t)std::min<uint64_t>(allocs.allocations, UINT32_MAX));
+        allocBytes.addSample((uint32_t)std::min<uint64_t>(allocs.bytes, UINT32_MAX));
+        if (picture) {
+            captureFrame(mainScene, picture.get(), frame, std::chrono::duration_cast<std::chrono::microseconds>(drawDone - physicsDone).count());
+            picture.reset();
+        }
+        // raster: the CPU draw time is the fill cost here
+        resolution.addSample(std::chrono::duration_cast<std::chrono::microseconds>(drawDone - physicsDone).count());
+        renderScale.store(resolution.getScale(), std::memory_order_relaxed);
+
+        if (pngDir) {
+            TRACE_SCOPE("png");
+            SkPixmap pixmap;
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/frame_%05zu.png", pngDir, frame);
+            SkFILEWStream stream(path);
+            if (!surface->peekPixels(&pixmap) || !stream.isValid() || !SkPngEncoder::Encode(&stream, pixmap, {})) {
+                fprintf(stderr, "Failed to write %s\n", path);
+                return -1;
+            }
+        }
+        auto encodeDone = std::chrono::steady_clock::now();
+
+        physicsTimes.addSample(std::chrono::duration_cast<std::chrono::microseconds>(physicsDone - start).count());
+        drawTimes.addSample(std::chrono::duration_cast<std::chrono::microseconds>(drawDone - physicsDone).count());
+        encodeTimes.addSample(std::chrono::duration_cast<std::chrono::microseconds>(encodeDone - drawDone).count());
+        if (metricsShm.isOpen()) {
+            publishMetrics(frame + 1, frame + 1, nullptr);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+    printf("headless: %zu frames, %zu balls, %.1f frames/s\n", frameCount, balls.size(), frameCount / seconds);
+    printf("%-8s %10s %10s %10s %10s\n", "phase", "p50 us", "p99 us", "min us", "max us");
+    auto report = [](const char* name, const perf::PerfBuffer& times) {
+        printf("%-8s %10u %10u %10u %10u\n", name, times.getPercentile(50.0), times.getPercentile(99.0), times.getMin(), times.getMax());
+    };
+    report("physics", physicsTimes);
+    report("draw", drawTimes);
+    if (mainScene.offscreenSurface) {
+        printf("adaptive resolution: scale %.2f at the end\n", resolution.getScale());
+    }
+    printf("redrawn pixels per frame: p50 %u, p99 %u, max %u of %d\n",
+           redrawnPixels.getPercentile(50.0), redrawnPixels.getPercentile(99.0), redrawnPixels.getMax(), width * height);
+    printf("heap allocations per frame (physics and draw): p50 %u (%u bytes), p99 %u (%u bytes), max %u\n",
+           allocations.getPercentile(50.0), allocBytes.getPercentile(50.0), allocations.getPercentile(99.0), allocBytes.getPercentile(99.0), allocations.getMax());
+    if (pngDir) {
+        report("png", encodeTimes);
+    }
+    closeCapture();
+    if (traceFile) {
+        dumpTrace();
+    }
+    return 0;
+}
+
+// Draws one frame of the scene into an offscreen target with the swapchain's format and
+// waits for it, so every pipeline the scene needs is compiled (or loaded from the
+// pipeline cache) before the first presented frame.
+bool warmUpPipelines(skgpu::graphite::Recorder* recorder) {
+    SkImageInfo info = SkImageInfo::Make(RENDER_WIDTH, RENDER_HEIGHT, kRGBA_8888_SkColorType, kPremul_SkAlphaType, SkColorSpace::MakeSRGB());
+    sk_sp<SkSurface> surface = SkSurfaces::RenderTarget(recorder, info);
+    if (!surface) {
+        fprintf(stderr, "Failed to create the warm-up surface\n");
+        return false;
+    }
+    uint64_t surfaceFrame = 0;
+    drawScene(mainScene, surface->getCanvas(), physicsState.acquire(), 1.0f, surfaceFrame);
+    // and the mirror's copy of the overlay into the window
+    sk_sp<SkSurface> mirror = desktopMirror ? SkSurfaces::RenderTarget(recorder, info) : nullptr;
+    if (mirror) {
+        mirror->getCanvas()->drawImage(SkSurfaces::AsImage(surface), 0, 0);
+    }
+    std::unique_ptr<skgpu::graphite::Recording> recording = recorder->snap();
+    sGraphiteContext->insertRecording({.fRecording = recording.get()});
+    sGraphiteContext->submit(skgpu::graphite::SyncToCpu::kYes);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    appStart = std::chrono::steady_clock::now();
+    size_t ballCount = 3;
+    size_t headlessFrames = 0;
+    const char* pngDir = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--balls") == 0 && i + 1 < argc) {
+            ballCount = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--physics-hz") == 0 && i + 1 < argc) {
+            physicsHz = std::max(1.0, atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            physicsThreads = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--no-collisions") == 0) {
+            ballCollisions = false;
+        }
+        else if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+            headlessFrames = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--png-dir") == 0 && i + 1 < argc) {
+            pngDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            framesInFlight = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--swapchain-images") == 0 && i + 1 < argc) {
+            requestedSwapchainImages = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            lateLatching = strcmp(mode, "fifo-latched") == 0;
+            if (strcmp(mode, "mailbox") == 0) {
+                presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            }
+            else if (strcmp(mode, "immediate") == 0) {
+                presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            }
+            else if (strcmp(mode, "fifo") == 0 || lateLatching) {
+                presentMode = VK_PRESENT_MODE_FIFO_KHR;
+            }
+            else {
+                fprintf(stderr, "Unknown present mode %s, use mailbox, immediate, fifo or fifo-latched\n", mode);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--adaptive-resolution") == 0 && i + 1 < argc) {
+            adaptiveTargetUs = strtoul(argv[++i], nullptr, 10);
+            resolution = perf::ResolutionController(adaptiveTargetUs);
+        }
+        else if (strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc) {
+            pipelineCacheDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-pipeline-cache") == 0) {
+            usePipelineCache = false;
+        }
+        else if (strcmp(argv[i], "--no-warmup") == 0) {
+            pipelineWarmup = false;
+        }
+        else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            const char* level = argv[++i];
+            if (strcmp(level, "quiet") == 0) {
+                logLevel = LOG_QUIET;
+            }
+            else if (strcmp(level, "info") == 0) {
+                logLevel = LOG_INFO;
+            }
+            else if (strcmp(level, "verbose") == 0) {
+                logLevel = LOG_VERBOSE;
+            }
+            else {
+                fprintf(stderr, "Unknown log level %s, use quiet, info or verbose\n", level);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+            perf::trace::setEnabled(true);
+        }
+        else if (strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) {
+            recordThreads = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--partial-redraw") == 0) {
+            partialRedraw = true;
+        }
+        else if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "vsync") == 0) {
+                pacingMode = sim::FrameScheduler::VSYNC;
+            }
+            else if (strcmp(mode, "fixed") == 0) {
+                pacingMode = sim::FrameScheduler::FIXED;
+            }
+            else if (strcmp(mode, "on-demand") == 0) {
+                pacingMode = sim::FrameScheduler::ON_DEMAND;
+            }
+            else {
+                fprintf(stderr, "Unknown pacing %s, use vsync, fixed or on-demand\n", mode);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--target-hz") == 0 && i + 1 < argc) {
+            targetHz = std::max(1.0, atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--no-mirror") == 0) {
+            desktopMirror = false;
+        }
+        else if (strcmp(argv[i], "--vr-stub") == 0) {
+            vrStub = true;
+            overlaySubmitter = &stubOverlay;
+        }
+        else if (strcmp(argv[i], "--validation") == 0) {
+            vulkanValidation = true;
+        }
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            captureFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture-frames") == 0 && i + 1 < argc) {
+            captureFrames = std::max<size_t>(1, strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--metrics-shm") == 0 && i + 1 < argc) {
+            metricsShmName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--batched") == 0) {
+            batchedBalls = true;
+        }
+        else if (strcmp(argv[i], "--event-driven") == 0) {
+            // balls do not interact in the event-driven engine
+            eventDriven = true;
+            ballCollisions = false;
+        }
+    }
+
+    // the upscaled offscreen image covers the whole frame, and workers record before the target is known
+    if (partialRedraw && (adaptiveTargetUs > 0 || recordThreads > 0)) {
+        fprintf(stderr, "--partial-redraw is ignored with --adaptive-resolution and --record-threads\n");
+        partialRedraw = false;
+    }
+    // without the mirror there is no acquire to pace by, and the record workers latch the
+    // physics state themselves so on-demand cannot look at it
+    if ((pacingMode == sim::FrameScheduler::VSYNC && !desktopMirror) || (pacingMode == sim::FrameScheduler::ON_DEMAND && recordThreads > 0)) {
+        fprintf(stderr, "--pacing %s is not available here, using fixed at %.0f Hz\n", pacingMode == sim::FrameScheduler::VSYNC ? "vsync" : "on-demand", targetHz);
+        pacingMode = sim::FrameScheduler::FIXED;
+    }
+
+    // the upscaled offscreen image is a texture, and workers record on their own threads
+    if (captureFile && (adaptiveTargetUs > 0 || recordThreads > 0)) {
+        fprintf(stderr, "--capture is ignored with --adaptive-resolution and --record-threads\n");
+        captureFile = nullptr;
+    }
+    // a partial frame only holds the damaged tiles, it cannot be replayed on its own
+    if (captureFile && partialRedraw) {
+        fprintf(stderr, "--partial-redraw is ignored while capturing\n");
+        partialRedraw = false;
+    }
+    if (captureFile && !capture.open(captureFile, RENDER_WIDTH, RENDER_HEIGHT, captureFrames)) {
+        return -1;
+    }
+    if (metricsShmName && !openMetricsShm()) {
+        return -1;
+    }
+
+    if (headlessFrames > 0) {
+        initializeBalls(ballCount);
+        initializePaints();
+        if (!initializeScene(mainScene, nullptr)) {
+            return -1;
+        }
+        physicsState.forEachSlot([](sim::BallSnapshot& snap) { snap.resize(balls.size()); });
+        return runHeadless(headlessFrames, pngDir);
+    }
+
+    // wall-clock time of every init phase, printed once the first frame is ready
+    perf::PhaseTimer startup;
+
     if (!glfwInit()) {
         fprintf(stderr, "Failed to initialize glfw\n");
         return -1;
@@ -343,12 +1267,14 @@ int main() {
         fprintf(stderr, "glfw does not support Vulkan\n");
         return -1;
     }
+    startup.mark("glfw");
 
     // OPENVR INIT
-    if(InitVR() != 0) {
+    if(!vrStub && InitVR() != 0) {
         fprintf(stderr, "Failed to initialize OpenVR\n");
         return -1;
     }
+    startup.mark("openvr");
     
 
     ///
@@ -364,9 +1290,9 @@ int main() {
     std::vector<VkExtensionProperties> instanceExtensions(instanceExtensionCount);
     vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, instanceExtensions.data());
 
-    printf("Found %d supported Vulkan instance extensions\n", instanceExtensionCount);
+    LOGI("Found %d supported Vulkan instance extensions\n", instanceExtensionCount);
     for (uint32_t i = 0; i < instanceExtensionCount; ++i) {
-        printf("  %s\n", instanceExtensions[i].extensionName);
+        LOGV("  %s\n", instanceExtensions[i].extensionName);
     }
     
     std::vector<const char*> requiredInstanceExtensions = {};
@@ -375,9 +1301,9 @@ int main() {
     const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
     // print required Vulkan extensions
-    printf("glfw Required Vulkan extensions:\n");
+    LOGV("glfw Required Vulkan extensions:\n");
     for (uint32_t i = 0; i < glfwExtensionCount; ++i) {
-        printf("  %s\n", glfwExtensions[i]);
+        LOGV("  %s\n", glfwExtensions[i]);
         requiredInstanceExtensions.push_back(glfwExtensions[i]);
     }
     
@@ -388,9 +1314,9 @@ int main() {
     skiaFeatures.addToInstanceExtensions(instanceExtensions.data(), instanceExtensionCount, requiredInstanceExtensions);
 
     // print requiredInstanceExtensions to see what Skia adds
-    printf("Skia required Instance extensions:\n");
+    LOGV("Skia required Instance extensions:\n");
     for (size_t c = glfwExtensionCount; c < requiredInstanceExtensions.size(); ++c) {
-        printf("  %s\n", requiredInstanceExtensions[c]);
+        LOGV("  %s\n", requiredInstanceExtensions[c]);
     }
     
     // vkinstance
@@ -406,12 +1332,41 @@ int main() {
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
     // enable required extensions
-    createInfo.enabledExtensionCount = glfwExtensionCount;
-    createInfo.ppEnabledExtensionNames = glfwExtensions;
+    std::vector<const char*> enabledInstanceExtensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+
+    // synchronization validation reports hazards between frames in flight, e.g. an overlay
+    // texture or swapchain image reused before the GPU is done with it; the layer logs to stdout
+    const char* validationLayer = "VK_LAYER_KHRONOS_validation";
+    VkValidationFeatureEnableEXT validationEnables[] = {VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT};
+    VkValidationFeaturesEXT validationFeatures = {};
+    validationFeatures.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+    validationFeatures.enabledValidationFeatureCount = 1;
+    validationFeatures.pEnabledValidationFeatures = validationEnables;
+    if (vulkanValidation) {
+        uint32_t layerCount = 0;
+        vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+        std::vector<VkLayerProperties> layers(layerCount);
+        vkEnumerateInstanceLayerProperties(&layerCount, layers.data());
+        bool found = std::any_of(layers.begin(), layers.end(), [&](const VkLayerProperties& layer) {
+            return strcmp(layer.layerName, validationLayer) == 0;
+        });
+        if (!found) {
+            fprintf(stderr, "--validation needs %s (Vulkan SDK or the vulkan-validationlayers package)\n", validationLayer);
+            return -1;
+        }
+        enabledInstanceExtensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+        createInfo.enabledLayerCount = 1;
+        createInfo.ppEnabledLayerNames = &validationLayer;
+        createInfo.pNext = &validationFeatures;
+        LOGI("Vulkan validation enabled, with synchronization validation\n");
+    }
+    createInfo.enabledExtensionCount = enabledInstanceExtensions.size();
+    createInfo.ppEnabledExtensionNames = enabledInstanceExtensions.data();
     if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
         fprintf(stderr, "Failed to create Vulkan instance\n");
         return -1;
     }
+    startup.mark("vulkan instance");
 
 
     ///
@@ -437,9 +1392,9 @@ int main() {
     std::vector<VkExtensionProperties> deviceExtensions(deviceExtensionCount);
     vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &deviceExtensionCount, deviceExtensions.data());
 
-    printf("Found %d supported Vulkan device extensions\n", deviceExtensionCount);
+    LOGI("Found %d supported Vulkan device extensions\n", deviceExtensionCount);
     for (uint32_t i = 0; i < deviceExtensionCount; ++i) {
-        printf("  %s\n", deviceExtensions[i].extensionName);
+        LOGV("  %s\n", deviceExtensions[i].extensionName);
     }
 
     VkPhysicalDeviceFeatures2 features = {};
@@ -453,9 +1408,9 @@ int main() {
 
     skiaFeatures.addFeaturesToEnable(requiredDeviceExtensions, features);
 
-    printf("Skia required Device extensions:\n");
+    LOGV("Skia required Device extensions:\n");
     for (size_t c = 0; c < requiredDeviceExtensions.size(); ++c) {
-        printf("  %s\n", requiredDeviceExtensions[c]);
+        LOGV("  %s\n", requiredDeviceExtensions[c]);
     }
 
     // we need a swapchain for Skia, so we need to ensure VK_KHR_swapchain is enabled
@@ -463,16 +1418,16 @@ int main() {
     requiredDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     
     // for OpenVR
-    uint32_t nBufferSize = vr::VRCompositor()->GetVulkanDeviceExtensionsRequired( ( VkPhysicalDevice_T * ) physicalDevice, nullptr, 0 );
+    uint32_t nBufferSize = vrStub ? 0 : vr::VRCompositor()->GetVulkanDeviceExtensionsRequired( ( VkPhysicalDevice_T * ) physicalDevice, nullptr, 0 );
     if ( nBufferSize > 0 )
 	{
         std::vector<char> buffer(nBufferSize);
         vr::VRCompositor()->GetVulkanDeviceExtensionsRequired( ( VkPhysicalDevice_T * ) physicalDevice, buffer.data(), nBufferSize );
-        printf("OpenVR requires Vulkan device extensions: %s\n", buffer.data());
+        LOGV("OpenVR requires Vulkan device extensions: %s\n", buffer.data());
         
         // split buffer by space character and add to requiredDeviceExtensions
         std::string bufferStr(buffer.begin(), buffer.end());
-        printf("OpenVR required device extensions 2: %s\n", bufferStr.c_str());
+        LOGV("OpenVR required device extensions 2: %s\n", bufferStr.c_str());
         std::istringstream iss(bufferStr);
         std::string extension;
 
@@ -483,9 +1438,9 @@ int main() {
         }
     }
 
-    printf("Device Extensions to load:\n");
+    LOGV("Device Extensions to load:\n");
     for(size_t c = 0; c < requiredDeviceExtensions.size(); ++c) {
-        printf("  %s\n", requiredDeviceExtensions[c]);
+        LOGV("  %s\n", requiredDeviceExtensions[c]);
     }
 
     ///
@@ -498,16 +1453,16 @@ int main() {
         return -1;
     }
     else {
-        printf("Found %d queue families\n", queueFamilyCount);
+        LOGV("Found %d queue families\n", queueFamilyCount);
     }
 
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
 
     for (uint32_t i = 0; i < queueFamilyCount; ++i) {
-        printf("Queue family %d: count = %d, flags = %u\n", i, queueFamilies[i].queueCount, queueFamilies[i].queueFlags);
+        LOGV("Queue family %d: count = %d, flags = %u\n", i, queueFamilies[i].queueCount, queueFamilies[i].queueFlags);
         if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            printf("Found graphics queue family at index %d\n", i);
+            LOGV("Found graphics queue family at index %d\n", i);
             graphicsQueueFamilyIndex = i;
         }
     }
@@ -533,18 +1488,19 @@ int main() {
     if (vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device) != VK_SUCCESS) {
         fprintf(stderr, "Failed to create Vulkan device\n");
         return -1;
-    }        
+    }
+    startup.mark("vulkan device");
 
     // create window
     GLFWwindow* window;
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    window = glfwCreateWindow(640, 480, "Skia Window", NULL, NULL);
+    window = glfwCreateWindow(RENDER_WIDTH, RENDER_HEIGHT, "Skia Window", NULL, NULL);
     if (!window) {
         fprintf(stderr, "Failed to create GLFW window\n");
         glfwTerminate();
         return -1;
     }
-    printf("GLFW window created successfully\n");
+    LOGV("GLFW window created successfully\n");
 
     VkSurfaceKHR surface;
     VkResult err = glfwCreateWindowSurface(instance, window, NULL, &surface);
@@ -553,7 +1509,7 @@ int main() {
         fprintf(stderr, "Failed to create window surface\n");
         return -1;
     }
-    printf("Vulkan surface created successfully\n");
+    LOGV("Vulkan surface created successfully\n");
 
     
 
@@ -565,7 +1521,11 @@ int main() {
         fprintf(stderr, "Failed to get graphics queue\n");
         return -1;
     }
-    printf("Graphics queue created successfully\n");
+    LOGV("Graphics queue created successfully\n");
+    if (adaptiveTargetUs > 0 && !gpuTimer.init(device, physicalDevice, graphicsQueueFamilyIndex, framesInFlight)) {
+        fprintf(stderr, "--adaptive-resolution follows the CPU draw time instead\n");
+    }
+    startup.mark("window");
 
     ///
     /// Skia Vulkan context
@@ -580,10 +1540,10 @@ int main() {
     backendContext.fDeviceFeatures2 = &features;
     backendContext.fGetProc = [](const char* proc_name, VkInstance instance, VkDevice device) {
 		if (device != VK_NULL_HANDLE) {
-            printf("GetProcAddr: %s (device)\n", proc_name);
+            LOGV("GetProcAddr: %s (device)\n", proc_name);
 			return vkGetDeviceProcAddr(device, proc_name);
 		}
-        printf("GetProcAddr: %s (instance)\n", proc_name);
+        LOGV("GetProcAddr: %s (instance)\n", proc_name);
 		return vkGetInstanceProcAddr(instance, proc_name);
 		};
     skgpu::VulkanExtensions vkExtensions;
@@ -594,17 +1554,28 @@ int main() {
     backendContext.fProtectedContext = skgpu::Protected(false);
 
     skgpu::graphite::ContextOptions options;
+    if (usePipelineCache) {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+        std::string dir = pipelineCacheDir ? pipelineCacheDir : perf::FilePipelineStorage::defaultDir();
+        pipelineStorage = std::make_unique<perf::FilePipelineStorage>(perf::FilePipelineStorage::pathFor(dir, deviceProperties));
+        options.fPersistentPipelineStorage = pipelineStorage.get();
+    }
     sGraphiteContext = skgpu::graphite::ContextFactory::MakeVulkan(backendContext, options);
     if (!sGraphiteContext) {
         fprintf(stderr, "Failed to create Skia Graphite Vulkan context\n");
         return -1;
     }
+    if (pipelineStorage) {
+        LOGI("Pipeline cache %s: %zu bytes loaded\n", pipelineStorage->getPath().c_str(), pipelineStorage->getLoadedSize());
+    }
 
-    auto recorder = sGraphiteContext->makeRecorder().release();
+    std::unique_ptr<skgpu::graphite::Recorder> recorder = sGraphiteContext->makeRecorder();
     if (!recorder) {
         printf("Could not make recorder\n");
         return 1;
     }
+    startup.mark("graphite context");
 
     // get surface formats
     uint32_t formatCount;
@@ -617,7 +1588,7 @@ int main() {
     }
     for(const auto& format : availableFormats) {
         if(format.format == VK_FORMAT_R8G8B8A8_UNORM && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-            printf("Found supported surface format: VK_FORMAT_R8G8B8A8_UNORM ColorSpace: VK_COLOR_SPACE_SRGB_NONLINEAR_KHR\n");
+            LOGV("Found supported surface format: VK_FORMAT_R8G8B8A8_UNORM ColorSpace: VK_COLOR_SPACE_SRGB_NONLINEAR_KHR\n");
             surfaceFormat = format;
             break;
         }
@@ -627,16 +1598,39 @@ int main() {
         return -1;
     }
 
+    // ask for the requested image count within the surface limits (maxImageCount 0 means no limit)
+    VkSurfaceCapabilitiesKHR surfaceCaps;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCaps);
+    uint32_t minImageCount = std::max(requestedSwapchainImages, surfaceCaps.minImageCount);
+    if (surfaceCaps.maxImageCount > 0) {
+        minImageCount = std::min(minImageCount, surfaceCaps.maxImageCount);
+    }
+
+    // use the requested present mode if the surface has it, FIFO is always available
+    uint32_t presentModeCount = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, nullptr);
+    std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
+    if (std::find(presentModes.begin(), presentModes.end(), presentMode) == presentModes.end()) {
+        fprintf(stderr, "Present mode %d not supported, falling back to FIFO\n", presentMode);
+        presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    }
+    // with record workers the physics state is latched when a worker starts a frame, and
+    // without the mirror there is no refresh to latch against
+    if (presentMode != VK_PRESENT_MODE_FIFO_KHR || recordThreads > 0 || !desktopMirror) {
+        lateLatching = false;
+    }
+
     // create swapchain
     VkSwapchainCreateInfoKHR swapchainCreateInfo{
         .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
         .pNext = nullptr,
         .flags = 0,
         .surface = surface,
-        .minImageCount = 2, // Double buffering
+        .minImageCount = minImageCount,
         .imageFormat = surfaceFormat.format,
         .imageColorSpace = surfaceFormat.colorSpace,
-        .imageExtent = VkExtent2D{ .width = 640, .height = 480}, // Set the size of the swapchain images
+        .imageExtent = VkExtent2D{ .width = RENDER_WIDTH, .height = RENDER_HEIGHT}, // Set the size of the swapchain images
         .imageArrayLayers = 1,
         .imageUsage = VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE, // Single queue family
@@ -644,7 +1638,7 @@ int main() {
         .pQueueFamilyIndices = nullptr,
         .preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR, // No transformation
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR, // Opaque composite alpha
-        .presentMode = VK_PRESENT_MODE_FIFO_KHR, // FIFO present mode
+        .presentMode = presentMode,
         .clipped = VK_FALSE, // Clipped rendering
         .oldSwapchain = VK_NULL_HANDLE // No old swapchain
     };
@@ -654,19 +1648,35 @@ int main() {
         return -1;
     }
 
-    // create semaphores and fence
-    VkSemaphoreCreateInfo sci{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, .pNext = nullptr, .flags = 0};
-    vkCreateSemaphore(device, &sci, nullptr, &imageAvailableSemaphore);
-    vkCreateSemaphore(device, &sci, nullptr, &renderFinishedSemaphore);
-    VkFenceCreateInfo fci{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, .pNext = nullptr, .flags = VK_FENCE_CREATE_SIGNALED_BIT};
-    vkCreateFence(device, &fci, nullptr, &frameFence);
-
     vkGetSwapchainImagesKHR(device, swapChain, &swapchainImageCount, nullptr);
     swapChainImages.resize(swapchainImageCount);
     vkGetSwapchainImagesKHR(device, swapChain, &swapchainImageCount, swapChainImages.data());
+    LOGI("Swapchain has %u images (asked for %u), %u frames in flight\n", swapchainImageCount, minImageCount, framesInFlight);
+
+    // create semaphores and fences: one set per frame in flight, one render semaphore per image
+    VkSemaphoreCreateInfo sci{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, .pNext = nullptr, .flags = 0};
+    VkFenceCreateInfo fci{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, .pNext = nullptr, .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+    frameSync.resize(framesInFlight);
+    for (auto& sync : frameSync) {
+        if (vkCreateSemaphore(device, &sci, nullptr, &sync.imageAvailable) != VK_SUCCESS ||
+            vkCreateSemaphore(device, &sci, nullptr, &sync.timerStarted) != VK_SUCCESS ||
+            vkCreateFence(device, &fci, nullptr, &sync.inFlight) != VK_SUCCESS) {
+            fprintf(stderr, "Failed to create frame synchronization objects\n");
+            return -1;
+        }
+    }
+    renderFinishedSemaphores.resize(swapchainImageCount);
+    for (auto& semaphore : renderFinishedSemaphores) {
+        if (vkCreateSemaphore(device, &sci, nullptr, &semaphore) != VK_SUCCESS) {
+            fprintf(stderr, "Failed to create frame synchronization objects\n");
+            return -1;
+        }
+    }
+    imageFences.assign(swapchainImageCount, VK_NULL_HANDLE);
+    startup.mark("swapchain");
 
     for(const auto& image : swapChainImages) {
-        printf("Swapchain image: %p\n", (void*)image);
+        LOGV("Swapchain image: %p\n", (void*)image);
         
         SkSurfaceProps props(0, kUnknown_SkPixelGeometry);
 
@@ -680,7 +1690,7 @@ int main() {
         vulkanTextureInfo.fFlags = VK_SAMPLE_COUNT_1_BIT;
 
         auto backendTexture = skgpu::graphite::BackendTextures::MakeVulkan(
-            SkISize::Make(640, 480),
+            SkISize::Make(RENDER_WIDTH, RENDER_HEIGHT),
             vulkanTextureInfo,
             VkImageLayout::VK_IMAGE_LAYOUT_UNDEFINED,
             (uint32_t)graphicsQueueFamilyIndex,
@@ -693,7 +1703,7 @@ int main() {
         }
 
         sk_sp<SkSurface> skiaSurface = SkSurfaces::WrapBackendTexture(
-            recorder,
+            recorder.get(),
             backendTexture,
             SkColorType::kRGBA_8888_SkColorType,
             SkColorSpace::MakeSRGB(),
@@ -708,32 +1718,176 @@ int main() {
         }
         else {
             skiaSwapChainSurfaces.push_back(skiaSurface);
-            printf("Created Skia surface for Graphite backend texture successfully\n");
+            LOGV("Created Skia surface for Graphite backend texture successfully\n");
+        }
+    }
+
+    // overlay render targets, allocated by Graphite and never presented
+    skgpu::graphite::VulkanTextureInfo overlayVkInfo{};
+    overlayVkInfo.fFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    overlayVkInfo.fSampleCount = 1;
+    overlayVkInfo.fImageTiling = VK_IMAGE_TILING_OPTIMAL;
+    overlayVkInfo.fImageUsageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    overlayVkInfo.fSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    overlayTextureInfo = skgpu::graphite::TextureInfos::MakeVulkan(overlayVkInfo);
+    overlayTargets.resize(framesInFlight);
+    for (auto& target : overlayTargets) {
+        target.texture = recorder->createBackendTexture(SkISize::Make(RENDER_WIDTH, RENDER_HEIGHT), overlayTextureInfo);
+        if (target.texture.isValid()) {
+            target.surface = SkSurfaces::WrapBackendTexture(recorder.get(), target.texture, kRGBA_8888_SkColorType, SkColorSpace::MakeSRGB(), nullptr, nullptr, nullptr, "overlay");
+        }
+        if (!target.surface) {
+            fprintf(stderr, "Failed to create an overlay texture\n");
+            return -1;
         }
+        target.image = {
+            .image = skgpu::graphite::BackendTextures::GetVkImage(target.texture),
+            .device = device,
+            .physicalDevice = physicalDevice,
+            .instance = instance,
+            .queue = graphicsQueue,
+            .queueFamilyIndex = (uint32_t)graphicsQueueFamilyIndex,
+            .width = RENDER_WIDTH,
+            .height = RENDER_HEIGHT,
+            .format = overlayVkInfo.fFormat,
+            .sampleCount = overlayVkInfo.fSampleCount
+        };
     }
+    // the runtime copies on our queue, so the images never change queue family
+    presentState = skgpu::MutableTextureStates::MakeVulkan(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, graphicsQueueFamilyIndex);
+    overlayReleaseState = skgpu::MutableTextureStates::MakeVulkan(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, graphicsQueueFamilyIndex);
+    startup.mark("surface wrapping");
 
+    initializeBalls(ballCount);
     initializePaints();
+    if (!initializeScene(mainScene, recorder.get())) {
+        return -1;
+    }
     last_drawcall = std::chrono::high_resolution_clock::now();
     
-    // start new thread for rendering
+    physicsState.forEachSlot([](sim::BallSnapshot& snap) { snap.resize(balls.size()); });
+    publishPhysicsState(balls.posX, balls.posY, std::chrono::steady_clock::now(), 0.0, 0);
+    startup.mark("scene");
+
+    if (pipelineWarmup) {
+        warmUpPipelines(recorder.get());
+        startup.mark("pipeline warm-up");
+    }
+
+    // pipelines live in the context, so the workers' recorders reuse the warmed-up ones
+    for (size_t w = 0; w < recordThreads; ++w) {
+        auto worker = std::make_unique<RecordWorker>();
+        worker->recorder = sGraphiteContext->makeRecorder();
+        if (!worker->recorder || !initializeScene(worker->scene, worker->recorder.get())) {
+            fprintf(stderr, "Failed to set up record worker %zu\n", w);
+            return -1;
+        }
+        worker->snap.resize(balls.size());
+        recordWorkers.push_back(std::move(worker));
+    }
+    if (recordThreads > 0) {
+        recordPipeline = std::make_unique<sim::OrderedPipeline<RecordedFrame>>(recordThreads, RECORD_QUEUE_DEPTH,
+            [](size_t) { perf::trace::setThreadName("record worker"); }, latchFrame, recordFrame);
+        startup.mark("record workers");
+    }
+    if (logLevel >= LOG_INFO) {
+        startup.print(stdout);
+    }
+
+    // physics and rendering run on their own threads and only meet in physicsState
+    // vsync pacing only measures; the monitor's refresh rate tells it when a refresh was missed.
+    // Only FIFO blocks in the acquire, with mailbox and immediate frames are paced at that rate instead
+    double pacingHz = targetHz;
+    if (pacingMode == sim::FrameScheduler::VSYNC) {
+        GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+        pacingHz = mode && mode->refreshRate > 0 ? mode->refreshRate : 60.0;
+        if (presentMode != VK_PRESENT_MODE_FIFO_KHR) {
+            fprintf(stderr, "--pacing vsync needs the fifo present mode, using fixed at %.0f Hz\n", pacingHz);
+            pacingMode = sim::FrameScheduler::FIXED;
+        }
+    }
+    scheduler = sim::FrameScheduler(pacingMode, pacingHz);
+
     std::atomic<bool> shouldRun(true);
+    auto renderStart = std::chrono::steady_clock::now();
+    std::thread physicsThread([&]() {
+        physics(shouldRun);
+    });
     std::thread renderThread([&]() {
-        while (shouldRun) {
-            physics();
+        perf::trace::setThreadName("render");
+        while (scheduler.waitForFrame(shouldRun, sceneChanged)) {
             draw();
+            if (metricsShm.isOpen()) {
+                sim::FrameScheduler::Stats pacing = scheduler.getStats();
+                publishMetrics(pacing.frames, presentedFrames, &pacing);
+            }
         }
     });
 
+    if (traceFile) {
+        glfwSetKeyCallback(window, [](GLFWwindow*, int key, int, int action, int) {
+            if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+                dumpTrace();
+            }
+        });
+    }
+
     while (!glfwWindowShouldClose(window)) {
         glfwWaitEvents();
     }
 
     // Cleanup
     shouldRun = false;
+    if (recordPipeline) {
+        // also wakes the render thread if it waits for a recording
+        recordPipeline->stop();
+    }
     renderThread.join();
-
-    //sSurface.reset();
-    //sContext.reset();
+    physicsThread.join();
+    double renderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+
+    // summary to compare present modes between runs
+    perf::PerfStats latency = frameLatency.getStats();
+    perf::PerfStats latchLatency = frameLatchLatency.getStats();
+    perf::PerfStats drawStats = frameTimesDraw.getStats();
+    if (traceFile) {
+        dumpTrace();
+    }
+    LOGI("acquire to present: p50 %u us, p99 %u us, max %u us (draw p99 %u us)\n", latency.p50, latency.p99, latency.max, drawStats.p99);
+    LOGI("latch to present: p50 %u us, p99 %u us, max %u us\n", latchLatency.p50, latchLatency.p99, latchLatency.max);
+    perf::PerfStats pixels = framePixels.getStats();
+    LOGI("redrawn pixels per frame: p50 %u, p99 %u, max %u of %d\n", pixels.p50, pixels.p99, pixels.max, RENDER_WIDTH * RENDER_HEIGHT);
+    perf::PerfStats allocs = frameAllocations.getStats();
+    perf::PerfStats allocBytes = frameAllocBytes.getStats();
+    LOGI("heap allocations per frame: p50 %u (%u bytes), p99 %u (%u bytes), max %u\n", allocs.p50, allocBytes.p50, allocs.p99, allocBytes.p99, allocs.max);
+    if (vrStub) {
+        LOGI("overlay stub: %llu submissions, %llu rejected, %zu distinct images\n",
+             (unsigned long long)stubOverlay.getSubmitted(), (unsigned long long)stubOverlay.getRejected(), stubOverlay.getImageCount());
+    }
+    sim::FrameScheduler::Stats pacing = scheduler.getStats();
+    LOGI("pacing at %.0f Hz: %llu frames, %llu missed deadlines, %llu idle slots, wake-up error p50 %u us p99 %u us\n",
+         pacingHz, (unsigned long long)pacing.frames, (unsigned long long)pacing.missed, (unsigned long long)pacing.skipped, pacing.wakeErrorP50Us, pacing.wakeErrorP99Us);
+    LOGI("CPU: render thread %.1f%%, process %.1f%%\n", pacing.threadCpuPercent, pacing.processCpuPercent);
+    closeCapture();
+    LOGI("presented %llu frames in %.1f s (%.1f frames/s, %zu record threads)\n",
+         (unsigned long long)presentedFrames, renderSeconds, presentedFrames / renderSeconds, recordThreads);
+
+    // tear Graphite down in order; destroying the context writes the pipeline cache
+    vkDeviceWaitIdle(device);
+    gpuTimer.destroy();
+    skiaSwapChainSurfaces.clear();
+    for (auto& target : overlayTargets) {
+        target.surface.reset();
+        sGraphiteContext->deleteBackendTexture(target.texture);
+    }
+    overlayTargets.clear();
+    recordPipeline.reset();
+    recordWorkers.clear();
+    mainScene.offscreenSurface.reset();
+    mainScene.ballRenderer = sim::BallRenderer();
+    recorder.reset();
+    sGraphiteContext.reset();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sharedperfbuffer.hpp"
+
+namespace perf
+{
+    // Frame counters published next to the perf series.
+    struct MetricsCounters
+    {
+        uint64_t frames = 0;
+        uint64_t presented = 0;
+        uint64_t missed = 0; // deadlines missed by the frame scheduler
+        uint64_t skipped = 0; // on-demand slots without a frame
+        uint64_t balls = 0;
+    };
+
+    struct MetricsSeries
+    {
+        std::string name;
+        std::string unit;
+        PerfStats stats;
+        std::vector<uint32_t> samples; // the newest up to METRICS_WINDOW, oldest first
+    };
+
+    struct MetricsSnapshot
+    {
+        uint32_t pid = 0;
+        uint64_t version = 0; // even, grows by 2 per publish
+        uint64_t updateNs = 0; // steady clock (CLOCK_MONOTONIC) of the last publish
+        MetricsCounters counters;
+        std::vector<MetricsSeries> series;
+    };
+
+    static constexpr const char* METRICS_DEFAULT_NAME = "/skiavr-metrics";
+    static constexpr size_t METRICS_MAX_SERIES = 8;
+    static constexpr size_t METRICS_WINDOW = 512;
+
+    // Layout of the shared-memory segment. Only fixed-size fields and address-free
+    // atomics, so the writer and readers may be different processes and builds of
+    // the same version. Everything below 'version' is covered by one seqlock: the
+    // writer bumps version to odd before and to even after each publish, readers
+    // retry when it changed while they were copying (the SharedPerfBuffer scheme).
+    // The strings and seriesCount are written once before magic is set.
+    struct MetricsSegment
+    {
+        static constexpr uint32_t MAGIC = 0x544d4b53; // "SKMT"
+        static constexpr uint32_t LAYOUT_VERSION = 1;
+        static constexpr size_t NAME_SIZE = 16;
+
+        struct Series
+        {
+            char name[NAME_SIZE];
+            char unit[NAME_SIZE];
+            std::atomic<uint32_t> stats[6]; // min, max, p50, p95, p99, p99.9
+            std::atomic<uint64_t> sampleCount;
+            std::atomic<uint32_t> ring[METRICS_WINDOW]; // sample n in slot n % METRICS_WINDOW
+        };
+
+        std::atomic<uint32_t> magic;
+        uint32_t layoutVersion;
+        uint32_t pid;
+        uint32_t seriesCount;
+        std::atomic<uint64_t> version;
+        std::atomic<uint64_t> updateNs;
+        std::atomic<uint64_t> counters[5];
+        Series series[METRICS_MAX_SERIES];
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "the metrics segment needs lock-free (address-free) atomics");
+
+    // Render process side. Series are registered before open(); publish() copies what
+    // their SharedPerfBuffers got since the last call (O(new samples)) plus the counters.
+    // It never waits for readers and does not allocate.
+    class MetricsWriter
+    {
+        public:
+            ~MetricsWriter() {
+                close();
+            }
+
+            void addSeries(const char* name, const char* unit, const SharedPerfBuffer* source) {
+                if (mSources.size() < METRICS_MAX_SERIES) {
+                    mSources.push_back({name, unit, source, 0, PerfStats(), std::vector<uint32_t>(METRICS_WINDOW)});
+                }
+            }
+
+            // creates the segment; name as for shm_open, e.g. METRICS_DEFAULT_NAME. One that
+            // already exists is only replaced when the process that wrote it is gone.
+            bool open(const char* name) {
+                int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+                if (fd < 0 && errno == EEXIST) {
+                    pid_t owner = findOwner(name);
+                    if (owner == 0) {
+                        fprintf(stderr, "Shared memory %s exists but is not a complete metrics segment; remove it if no writer is starting\n", name);
+                        return false;
+                    }
+                    if (kill(owner, 0) == 0 || errno == EPERM) {
+                        fprintf(stderr, "Shared memory %s is in use by process %d\n", name, (int)owner);
+                        return false;
+                    }
+                    // left behind by a writer that crashed
+                    shm_unlink(name);
+                    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+                }
+                if (fd < 0) {
+                    fprintf(stderr, "Failed to create shared memory %s: %s\n", name, strerror(errno));
+                    return false;
+                }
+                if (ftruncate(fd, sizeof(MetricsSegment)) != 0) {
+                    fprintf(stderr, "Failed to size shared memory %s: %s\n", name, strerror(errno));
+                    ::close(fd);
+                    return false;
+                }
+                void* memory = mmap(nullptr, sizeof(MetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                ::close(fd);
+                if (memory == MAP_FAILED) {
+                    fprintf(stderr, "Failed to map shared memory %s: %s\n", name, strerror(errno));
+                    return false;
+                }
+
+                mName = name;
+                mSegment = new (memory) MetricsSegment();
+                mSegment->layoutVersion = MetricsSegment::LAYOUT_VERSION;
+                mSegment->pid = (uint32_t)getpid();
+                mSegment->seriesCount = (uint32_t)mSources.size();
+                for (size_t i = 0; i < mSources.size(); ++i) {
+                    snprintf(mSegment->series[i].name, MetricsSegment::NAME_SIZE, "%s", mSources[i].name);
+                    snprintf(mSegment->series[i].unit, MetricsSegment::NAME_SIZE, "%s", mSources[i].unit);
+                }
+                mSegment->magic.store(MetricsSegment::MAGIC, std::memory_order_release);
+                return true;
+            }
+
+            // unmaps and removes the name; readers that still have it mapped keep the last values
+            void close() {
+                if (mSegment) {
+                    munmap(mSegment, sizeof(MetricsSegment));
+                    shm_unlink(mName.c_str());
+                    mSegment = nullptr;
+                }
+            }
+
+            bool isOpen() const { return mSegment != nullptr; }
+
+            // pid of the writer of an existing segment, 0 if it holds no complete segment
+            static pid_t findOwner(const char* name) {
+                int fd = shm_open(name, O_RDONLY, 0);
+                if (fd < 0) {
+                    return 0;
+                }
+                struct stat info;
+                void* memory = fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(MetricsSegment)
+                             ? mmap(nullptr, sizeof(MetricsSegment), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+                ::close(fd);
+                if (memory == MAP_FAILED) {
+                    return 0;
+                }
+                const MetricsSegment* segment = static_cast<const MetricsSegment*>(memory);
+                pid_t owner = segment->magic.load(std::memory_order_acquire) == MetricsSegment::MAGIC ? (pid_t)segment->pid : 0;
+                munmap(memory, sizeof(MetricsSegment));
+                return owner;
+            }
+
+            // one thread only
+            void publish(const MetricsCounters& counters) {
+                if (!mSegment) {
+                    return;
+                }
+                // gather before the write section so readers rarely have to retry
+                for (Source& source : mSources) {
+                    source.fresh = source.buffer->readSince(source.cursor, source.scratch.data(), METRICS_WINDOW, source.stats);
+                }
+
+                uint64_t version = mSegment->version.load(std::memory_order_relaxed);
+                mSegment->version.store(version + 1, std::memory_order_relaxed);
+
+                // release stores keep the odd version ordered before the data
+                for (size_t i = 0; i < mSources.size(); ++i) {
+                    const Source& source = mSources[i];
+                    MetricsSegment::Series& series = mSegment->series[i];
+                    uint64_t first = source.stats.sampleCount - source.fresh;
+                    for (size_t s = 0; s < source.fresh; ++s) {
+                        series.ring[(first + s) % METRICS_WINDOW].store(source.scratch[s], std::memory_order_release);
+                    }
+                    const uint32_t stats[6] = {source.stats.min, source.stats.max, source.stats.p50, source.stats.p95, source.stats.p99, source.stats.p999};
+                    for (size_t s = 0; s < 6; ++s) {
+                        series.stats[s].store(stats[s], std::memory_order_release);
+                    }
+                    series.sampleCount.store(source.stats.sampleCount, std::memory_order_release);
+                }
+                const uint64_t values[5] = {counters.frames, counters.presented, counters.missed, counters.skipped, counters.balls};
+                for (size_t c = 0; c < 5; ++c) {
+                    mSegment->counters[c].store(values[c], std::memory_order_release);
+                }
+                uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                mSegment->updateNs.store(now, std::memory_order_release);
+
+                mSegment->version.store(version + 2, std::memory_order_release);
+            }
+
+        private:
+            struct Source
+            {
+                const char* name;
+                const char* unit;
+                const SharedPerfBuffer* buffer;
+                uint64_t cursor;
+                PerfStats stats;
+                std::vector<uint32_t> scratch;
+                size_t fresh = 0;
+            };
+
+            std::string mName;
+            MetricsSegment* mSegment = nullptr;
+            std::vector<Source> mSources;
+    };
+
+    // Any process; maps the segment read-only, so a reader can never disturb the writer.
+    class MetricsReader
+    {
+        public:
+            ~MetricsReader() {
+                close();
+            }
+
+            bool open(const char* name) {
+                int fd = shm_open(name, O_RDONLY, 0);
+                if (fd < 0) {
+                    fprintf(stderr, "Failed to open shared memory %s: %s\n", name, strerror(errno));
+                    return false;
+                }
+                struct stat info;
+                if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(MetricsSegment)) {
+                    fprintf(stderr, "Shared memory %s is not a metrics segment\n", name);
+                    ::close(fd);
+                    return false;
+                }
+                void* memory = mmap(nullptr, sizeof(MetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+                ::close(fd);
+                if (memory == MAP_FAILED) {
+                    fprintf(stderr, "Failed to map shared memory %s: %s\n", name, strerror(errno));
+                    return false;
+                }
+                mSegment = static_cast<const MetricsSegment*>(memory);
+                if (mSegment->magic.load(std::memory_order_acquire) != MetricsSegment::MAGIC || mSegment->layoutVersion != MetricsSegment::LAYOUT_VERSION) {
+                    fprintf(stderr, "Shared memory %s has an unknown layout\n", name);
+                    close();
+                    return false;
+                }
+                return true;
+            }
+
+            void close() {
+                if (mSegment) {
+                    munmap(const_cast<MetricsSegment*>(mSegment), sizeof(MetricsSegment));
+                    mSegment = nullptr;
+                }
+            }
+
+            // single attempt, returns false if the writer raced us
+            bool tryRead(MetricsSnapshot& out) const {
+                uint64_t before = mSegment->version.load(std::memory_order_acquire);
+                if (before & 1) {
+                    return false;
+                }
+                size_t count = std::min<size_t>(mSegment->seriesCount, METRICS_MAX_SERIES);
+                out.pid = mSegment->pid;
+                out.version = before;
+                out.series.resize(count);
+                for (size_t i = 0; i < count; ++i) {
+                    const MetricsSegment::Series& series = mSegment->series[i];
+                    MetricsSeries& dst = out.series[i];
+                    // constant after open(), but assigning only on change keeps steady-state reads allocation-free
+                    if (dst.name != series.name || dst.unit != series.unit) {
+                        dst.name.assign(series.name, strnlen(series.name, MetricsSegment::NAME_SIZE));
+                        dst.unit.assign(series.unit, strnlen(series.unit, MetricsSegment::NAME_SIZE));
+                    }
+                    // acquire loads keep the closing version check ordered after the data
+                    uint32_t stats[6];
+                    for (size_t s = 0; s < 6; ++s) {
+                        stats[s] = series.stats[s].load(std::memory_order_acquire);
+                    }
+                    dst.stats = {stats[0], stats[1], stats[2], stats[3], stats[4], stats[5], series.sampleCount.load(std::memory_order_acquire)};
+                    uint64_t window = std::min<uint64_t>(dst.stats.sampleCount, METRICS_WINDOW);
+                    uint64_t first = dst.stats.sampleCount - window;
+                    dst.samples.resize(window);
+                    for (size_t s = 0; s < window; ++s) {
+                        dst.samples[s] = series.ring[(first + s) % METRICS_WINDOW].load(std::memory_order_acquire);
+                    }
+                }
+                uint64_t values[5];
+                for (size_t c = 0; c < 5; ++c) {
+                    values[c] = mSegment->counters[c].load(std::memory_order_acquire);
+                }
+                out.counters = {values[0], values[1], values[2], values[3], values[4]};
+                out.updateNs = mSegment->updateNs.load(std::memory_order_acquire);
+                return mSegment->version.load(std::memory_order_relaxed) == before;
+            }
+
+            // retries for a while; false if the writer stays in a publish (e.g. it died in one)
+            bool read(MetricsSnapshot& out) const {
+                for (int attempt = 0; attempt < 1000; ++attempt) {
+                    if (tryRead(out)) {
+                        return true;
+                    }
+                    std::this_thread::yield();
+                }
+                return false;
+            }
+
+        private:
+            const MetricsSegment* mSegment = nullptr;
+    };
+}
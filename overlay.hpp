@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vulkan/vulkan.h>
+
+#include "openvr/openvr.h"
+
+namespace sim
+{
+    // A rendered Vulkan image handed to a VR overlay, the fields of vr::VRVulkanTextureData_t.
+    // The image is left in TRANSFER_SRC_OPTIMAL, which is where the runtime copies it from.
+    struct OverlayImage
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkDevice device = VK_NULL_HANDLE;
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkInstance instance = VK_NULL_HANDLE;
+        VkQueue queue = VK_NULL_HANDLE;
+        uint32_t queueFamilyIndex = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t sampleCount = 1;
+    };
+
+    // The texture IVROverlay::SetOverlayTexture takes for image; its handle points to vulkanData,
+    // which has to outlive the call.
+    inline vr::Texture_t makeOverlayTexture(const OverlayImage& image, vr::VRVulkanTextureData_t& vulkanData) {
+        vulkanData = {
+            .m_nImage = (uint64_t)image.image,
+            .m_pDevice = image.device,
+            .m_pPhysicalDevice = image.physicalDevice,
+            .m_pInstance = image.instance,
+            .m_pQueue = image.queue,
+            .m_nQueueFamilyIndex = image.queueFamilyIndex,
+            .m_nWidth = image.width,
+            .m_nHeight = image.height,
+            .m_nFormat = (uint32_t)image.format,
+            .m_nSampleCount = image.sampleCount
+        };
+        return {
+            .handle = &vulkanData,
+            .eType = vr::TextureType_Vulkan,
+            .eColorSpace = vr::ColorSpace_Gamma
+        };
+    }
+
+    // Where finished overlay frames go: IVROverlay::SetOverlayTexture in the app,
+    // StubOverlaySubmitter without SteamVR.
+    class OverlaySubmitter
+    {
+        public:
+            virtual ~OverlaySubmitter() = default;
+            // texture as built by makeOverlayTexture(); the runtime reads the image with work it
+            // queues on the texture's queue, so the image must not be rendered to again before
+            // that work has run
+            virtual bool submit(const vr::Texture_t& texture) = 0;
+    };
+
+    // Stands in for IVROverlay::SetOverlayTexture without a VR runtime. Checks the
+    // vr::Texture_t the app would pass, and the VRVulkanTextureData_t it points to,
+    // against what the runtime requires (a Vulkan texture with a known color space, a
+    // complete handle set, a sized single-sample image), and counts the submissions and
+    // the distinct images, so the submission path can run on any Vulkan device.
+    class StubOverlaySubmitter : public OverlaySubmitter
+    {
+        public:
+            static constexpr size_t MAX_IMAGES = 16;
+
+            bool submit(const vr::Texture_t& texture) override {
+                mSubmitted++;
+                const vr::VRVulkanTextureData_t* data = static_cast<const vr::VRVulkanTextureData_t*>(texture.handle);
+                const char* problem = nullptr;
+                if (texture.eType != vr::TextureType_Vulkan || !data) {
+                    problem = "not a Vulkan texture";
+                }
+                else if (texture.eColorSpace != vr::ColorSpace_Auto && texture.eColorSpace != vr::ColorSpace_Gamma &&
+                         texture.eColorSpace != vr::ColorSpace_Linear) {
+                    problem = "unknown color space";
+                }
+                else if (!data->m_nImage || !data->m_pDevice || !data->m_pPhysicalDevice || !data->m_pInstance || !data->m_pQueue) {
+                    problem = "missing Vulkan handle";
+                }
+                else if (data->m_nWidth == 0 || data->m_nHeight == 0 || data->m_nFormat == VK_FORMAT_UNDEFINED) {
+                    problem = "no size or format";
+                }
+                else if (data->m_nSampleCount != 1) {
+                    problem = "multisampled image";
+                }
+                if (problem) {
+                    if (mRejected++ == 0) {
+                        fprintf(stderr, "Overlay stub rejected image %#llx: %s\n", data ? (unsigned long long)data->m_nImage : 0ull, problem);
+                    }
+                    return false;
+                }
+                noteImage(data->m_nImage);
+                return true;
+            }
+
+            uint64_t getSubmitted() const { return mSubmitted; }
+            uint64_t getRejected() const { return mRejected; }
+            // distinct images seen, the overlay ring size if submissions rotate as they should;
+            // counting stops at MAX_IMAGES
+            size_t getImageCount() const { return mImageCount; }
+
+        private:
+            // a linear scan of a few entries, no allocation per frame
+            void noteImage(uint64_t image) {
+                for (size_t i = 0; i < mImageCount; ++i) {
+                    if (mImages[i] == image) {
+                        return;
+                    }
+                }
+                if (mImageCount < MAX_IMAGES) {
+                    mImages[mImageCount++] = image;
+                }
+            }
+
+            uint64_t mSubmitted = 0;
+            uint64_t mRejected = 0;
+            uint64_t mImages[MAX_IMAGES] = {};
+            size_t mImageCount = 0;
+    };
+}
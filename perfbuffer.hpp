@@ -5,47 +5,201 @@
 #include <vector>
 #include <algorithm>
 #include <limits>
-#include <set>
+#include <functional>
+#include <bit>
+#include <cmath>
 
 namespace perf
 {
-    class PerfBuffer
+    // Sliding window extremum over a fixed ring of (sequence, value) pairs.
+    // Values are kept monotonic so the front is always the current min (std::less)
+    // or max (std::greater). Every sample is pushed and popped at most once,
+    // so updates are O(1) amortized and never allocate after construction.
+    template<typename Compare>
+    class MonotonicWindow
     {
         public:
-            PerfBuffer(size_t size) : mSize(size), mSamples(size, 0), currentIndex(0), minVal(0), maxVal(0) {
-                for (size_t i = 0; i < mSize; ++i) {
-                    mValueSet.insert(0);
+            MonotonicWindow(size_t capacity) : mCapacity(capacity), mEntries(capacity) {}
+
+            void push(uint64_t seq, uint32_t value) {
+                while (mCount > 0 && !mCompare(back().value, value)) {
+                    mCount--;
+                }
+                size_t idx = mHead + mCount;
+                if (idx >= mCapacity) {
+                    idx -= mCapacity;
+                }
+                mEntries[idx] = {seq, value};
+                mCount++;
+            }
+
+            // drop all entries older than oldestSeq
+            void expire(uint64_t oldestSeq) {
+                while (mCount > 0 && mEntries[mHead].seq < oldestSeq) {
+                    mHead = (mHead + 1 == mCapacity) ? 0 : mHead + 1;
+                    mCount--;
                 }
-                updateMinMax();
             }
-            ~PerfBuffer() {
-                mSamples.clear();
-                mValueSet.clear();
+
+            void clear() {
+                mHead = 0;
+                mCount = 0;
             }
 
-            void addSample(uint32_t sample) {
-                currentIndex = (currentIndex + 1) % mSize;
-                uint32_t old = mSamples[currentIndex];
-                auto it = mValueSet.find(old);
-                if (it != mValueSet.end()) {
-                    mValueSet.erase(it);
+            // shift all sequence numbers down by base
+            void rebase(uint64_t base) {
+                for (size_t i = 0, idx = mHead; i < mCount; ++i, idx = (idx + 1 == mCapacity) ? 0 : idx + 1) {
+                    mEntries[idx].seq -= base;
                 }
-                mSamples[currentIndex] = sample;
-                mValueSet.insert(sample);
-                updateMinMax();
+            }
+
+            bool empty() const { return mCount == 0; }
+            uint32_t front() const { return mEntries[mHead].value; }
+
+        private:
+            struct Entry {
+                uint64_t seq;
+                uint32_t value;
+            };
+
+            const Entry& back() const {
+                size_t idx = mHead + mCount - 1;
+                return mEntries[idx >= mCapacity ? idx - mCapacity : idx];
+            }
+
+            size_t mCapacity;
+            std::vector<Entry> mEntries;
+            size_t mHead = 0;
+            size_t mCount = 0;
+            Compare mCompare;
+    };
+
+    // Fixed-size log-bucketed (HDR style) histogram over uint32 values.
+    // Values below 2^SUB_BITS get an exact bucket, larger values are split into
+    // 2^SUB_BITS linear sub-buckets per power of two, which bounds the relative
+    // error of a bucket to 1/2^SUB_BITS (~3%).
+    class LogHistogram
+    {
+        public:
+            static constexpr uint32_t SUB_BITS = 5;
+            static constexpr uint32_t SUB_COUNT = 1u << SUB_BITS;
+            static constexpr size_t BUCKET_COUNT = (32 - SUB_BITS + 1) * SUB_COUNT;
+
+            LogHistogram() : mCounts(BUCKET_COUNT, 0) {}
+
+            static size_t bucketIndex(uint32_t value) {
+                if (value < SUB_COUNT) {
+                    return value;
+                }
+                uint32_t exponent = 31 - std::countl_zero(value);
+                uint32_t shift = exponent - SUB_BITS;
+                return (shift + 1) * SUB_COUNT + ((value >> shift) - SUB_COUNT);
+            }
+
+            // largest value that falls into the given bucket
+            static uint32_t bucketUpperBound(size_t index) {
+                if (index < SUB_COUNT) {
+                    return (uint32_t)index;
+                }
+                uint32_t shift = (uint32_t)(index / SUB_COUNT) - 1;
+                uint64_t sub = SUB_COUNT + index % SUB_COUNT;
+                return (uint32_t)(((sub + 1) << shift) - 1);
+            }
+
+            void add(uint32_t value, uint32_t count = 1) {
+                mCounts[bucketIndex(value)] += count;
+                mTotal += count;
+            }
+
+            void remove(uint32_t value) {
+                mCounts[bucketIndex(value)]--;
+                mTotal--;
             }
 
             void clear() {
-                for (auto& sample : mSamples) {
-                    sample = 0;
+                std::fill(mCounts.begin(), mCounts.end(), 0);
+                mTotal = 0;
+            }
+
+            // p in [0, 100]; returns the upper bound of the bucket holding the sample of that rank
+            uint32_t getPercentile(double p) const {
+                if (mTotal == 0) {
+                    return 0;
                 }
-                mValueSet.clear();
-                for (size_t i = 0; i < mSize; ++i) {
-                    mValueSet.insert(0);
+                uint64_t rank = (uint64_t)std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * mTotal);
+                rank = std::max<uint64_t>(rank, 1);
+                uint64_t seen = 0;
+                for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                    seen += mCounts[i];
+                    if (seen >= rank) {
+                        return bucketUpperBound(i);
+                    }
                 }
+                return bucketUpperBound(BUCKET_COUNT - 1);
+            }
+
+            // single pass variant; percentiles must be sorted ascending
+            void getPercentiles(const double* percentiles, uint32_t* out, size_t count) const {
+                size_t i = 0;
+                uint64_t seen = 0;
+                for (size_t p = 0; p < count; ++p) {
+                    if (mTotal == 0) {
+                        out[p] = 0;
+                        continue;
+                    }
+                    uint64_t rank = (uint64_t)std::ceil(std::clamp(percentiles[p], 0.0, 100.0) / 100.0 * mTotal);
+                    rank = std::max<uint64_t>(rank, 1);
+                    while (i < BUCKET_COUNT - 1 && seen + mCounts[i] < rank) {
+                        seen += mCounts[i];
+                        i++;
+                    }
+                    out[p] = bucketUpperBound(i);
+                }
+            }
+
+            uint64_t getTotal() const { return mTotal; }
+
+        private:
+            std::vector<uint32_t> mCounts;
+            uint64_t mTotal = 0;
+    };
+
+    class PerfBuffer
+    {
+        public:
+            PerfBuffer(size_t size) : mSize(size), mSamples(size, 0), mMinWindow(size), mMaxWindow(size) {
+                clear();
+            }
+
+            void addSample(uint32_t sample) {
+                currentIndex = (currentIndex + 1 == mSize) ? 0 : currentIndex + 1;
+                mHistogram.remove(mSamples[currentIndex]);
+                mHistogram.add(sample);
+                mSamples[currentIndex] = sample;
+
+                uint64_t seq = mSeq++;
+                uint64_t oldest = seq + 1 - mSize;
+                mMinWindow.expire(oldest);
+                mMaxWindow.expire(oldest);
+                mMinWindow.push(seq, sample);
+                mMaxWindow.push(seq, sample);
+                updateMinMax();
+            }
+
+            void clear() {
+                std::fill(mSamples.begin(), mSamples.end(), 0);
                 currentIndex = 0;
-                minVal = 0;
-                maxVal = 0;
+                mHistogram.clear();
+                mHistogram.add(0, (uint32_t)mSize);
+
+                // the buffer starts out holding mSize zero samples; the newest one
+                // stands in for all of them in both windows
+                mSeq = mSize;
+                mMinWindow.clear();
+                mMaxWindow.clear();
+                mMinWindow.push(mSeq - 1, 0);
+                mMaxWindow.push(mSeq - 1, 0);
+                updateMinMax();
             }
 
             uint32_t getOrderedSample(size_t i) const {
@@ -57,22 +211,86 @@ namespace perf
             uint32_t getMin() const { return minVal; }
             uint32_t getMax() const { return maxVal; }
 
+            // percentile over the current window, p in [0, 100]. Accurate to the
+            // histogram bucket width and clamped to the exact window min/max.
+            uint32_t getPercentile(double p) const {
+                return std::clamp(mHistogram.getPercentile(p), minVal, maxVal);
+            }
+
+            // several percentiles in one histogram pass; percentiles must be sorted ascending
+            void getPercentiles(const double* percentiles, uint32_t* out, size_t count) const {
+                mHistogram.getPercentiles(percentiles, out, count);
+                for (size_t i = 0; i < count; ++i) {
+                    out[i] = std::clamp(out[i], minVal, maxVal);
+                }
+            }
+
+            size_t getSize() const { return mSize; }
+
         private:
             void updateMinMax() {
-                if (mValueSet.empty()) {
-                    minVal = 0;
-                    maxVal = 0;
-                    return;
-                }
-                minVal = *mValueSet.begin();
-                maxVal = *mValueSet.rbegin();
+                minVal = mMinWindow.empty() ? 0 : mMinWindow.front();
+                maxVal = mMaxWindow.empty() ? 0 : mMaxWindow.front();
             }
 
             size_t mSize;
             std::vector<uint32_t> mSamples;
-            std::multiset<uint32_t> mValueSet;
+            MonotonicWindow<std::less<uint32_t>> mMinWindow;
+            MonotonicWindow<std::greater<uint32_t>> mMaxWindow;
+            LogHistogram mHistogram;
+            uint64_t mSeq = 0;
             size_t currentIndex = 0;
             uint32_t minVal = 0;
             uint32_t maxVal = 0;
     };
-}
\ No newline at end of file
+
+    // Finds where startup hitches end: the first run of 'window' frames whose slowest
+    // frame is within 'factor' times their median.
+    class StableFrameDetector
+    {
+        public:
+            StableFrameDetector(size_t window = 30, double factor = 2.0) : mRecent(window), mTimes(window), mFactor(factor) {}
+
+            // true exactly once, for the frame that completes the first stable run;
+            // timeMs is when the frame was done, e.g. since startup
+            bool addFrame(uint32_t frameUs, double timeMs = 0.0) {
+                if (mStable) {
+                    return false;
+                }
+                mTimes[mFrames % mTimes.size()] = timeMs;
+                mRecent.addSample(frameUs);
+                if (++mFrames < mRecent.getSize()) {
+                    return false;
+                }
+                mStable = mRecent.getMax() <= mFactor * mRecent.getPercentile(50.0);
+                return mStable;
+            }
+
+            bool isStable() const { return mStable; }
+            // index of the first frame of the stable run
+            uint64_t getStableFrame() const { return mFrames - mRecent.getSize(); }
+            // timeMs passed with that frame: the time to the first stable frame, without the
+            // window of frames it took to confirm it
+            double getStableFrameTime() const { return mTimes[getStableFrame() % mTimes.size()]; }
+
+        private:
+            PerfBuffer mRecent;
+            std::vector<double> mTimes; // timeMs of the last window frames, by frame index
+            double mFactor;
+            uint64_t mFrames = 0;
+            bool mStable = false;
+    };
+
+    // linear map of x from [in_min, in_max] to [out_min, out_max], used to scale graph samples
+    uint32_t inline map(uint32_t x, uint32_t in_min, uint32_t in_max, uint32_t out_min, uint32_t out_max) {
+        // Avoid division by zero
+        if (in_max == in_min) {
+            return out_min; // Return out_min as a safe default
+        }
+
+        // Compute using 64-bit arithmetic to prevent overflow
+        uint64_t numerator = (uint64_t)(x - in_min) * (out_max - out_min);
+        uint64_t denominator = in_max - in_min;
+        return out_min + (uint32_t)(numerator / denominator);
+    }
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+
+#include "include/core/SkCanvas.h"
+#include "include/core/SkMatrix.h"
+#include "include/core/SkPaint.h"
+#include "include/core/SkPath.h"
+#include "include/core/SkPoint.h"
+#include "include/core/SkRect.h"
+#include "perfbuffer.hpp"
+#include "sharedperfbuffer.hpp"
+
+namespace perf
+{
+    // Polyline through samples (oldest first), one pixel per sample starting at (left, top),
+    // scaled so min sits on the bottom edge and max on the top edge of a box 'height' high.
+    void inline buildGraphPath(SkPath& path, const uint32_t* samples, size_t count, uint32_t min, uint32_t max, int left, int top, int height) {
+        path.reset();
+        for (size_t c = 0; c < count; ++c) {
+            auto y = map(samples[c], min, max, 0, height);
+            SkPoint point = SkPoint::Make(c + left, height - y + top);
+            c == 0 ? path.moveTo(point) : path.lineTo(point);
+        }
+    }
+
+    // Perf graph that only touches what changed each frame.
+    // Every series keeps a pre-allocated vertex ring of (sequence number, raw sample)
+    // points, stored twice back to back so the visible history is always one
+    // contiguous array. update() appends the samples published since the last frame,
+    // and draw() maps raw values into the box with a canvas matrix instead of
+    // re-normalizing the points, so the per-frame CPU cost does not depend on the
+    // history length. The y range comes from monotonic min/max windows over the
+    // history and the p99 line from the source buffer's published stats.
+    class PerfGraph
+    {
+        public:
+            PerfGraph(SkRect bounds, size_t history) : mBounds(bounds), mHistory(history) {}
+
+            void addSeries(const SharedPerfBuffer* source, const SkPaint& linePaint, const SkPaint& p99Paint) {
+                mSeries.push_back(std::make_unique<Series>(source, mHistory, linePaint, p99Paint));
+            }
+
+            // pull new samples of every series, O(new samples)
+            void update() {
+                for (auto& series : mSeries) {
+                    series->update();
+                }
+            }
+
+            const SkRect& getBounds() const { return mBounds; }
+
+            void draw(SkCanvas* canvas, const SkPaint& boxPaint) const {
+                canvas->drawRect(mBounds, boxPaint);
+                for (const auto& series : mSeries) {
+                    series->draw(canvas, mBounds);
+                }
+            }
+
+        private:
+            class Series
+            {
+                public:
+                    Series(const SharedPerfBuffer* source, size_t history, const SkPaint& linePaint, const SkPaint& p99Paint)
+                        : mSource(source), mHistory(history), mPoints(2 * history), mScratch(history),
+                          mMinWindow(history), mMaxWindow(history), mLinePaint(linePaint), mP99Paint(p99Paint) {
+                        // hairlines keep their width under the scaling matrix
+                        mLinePaint.setStrokeWidth(0);
+                        mLinePaint.setStyle(SkPaint::kStroke_Style);
+                        // start out with a history of zeros, like PerfBuffer
+                        for (size_t i = 0; i < mHistory; ++i) {
+                            append(0);
+                        }
+                    }
+
+                    void update() {
+                        size_t n = mSource->readSince(mCursor, mScratch.data(), mScratch.size(), mStats);
+                        for (size_t i = 0; i < n; ++i) {
+                            append(mScratch[i]);
+                        }
+                    }
+
+                    void draw(SkCanvas* canvas, const SkRect& bounds) const {
+                        uint32_t min = mMinWindow.front();
+                        uint32_t max = std::max(mMaxWindow.front(), min + 1);
+                        float sx = bounds.width() / (float)(mHistory - 1);
+                        float sy = bounds.height() / (float)(max - min);
+                        float firstX = mPoints[mWrite].x();
+
+                        SkMatrix matrix = SkMatrix::Translate(bounds.left(), bounds.bottom());
+                        matrix.preScale(sx, -sy);
+                        matrix.preTranslate(-firstX, -(float)min);
+
+                        canvas->save();
+                        canvas->concat(matrix);
+                        canvas->drawPoints(SkCanvas::kPolygon_PointMode, mHistory, mPoints.data() + mWrite, mLinePaint);
+                        canvas->restore();
+
+                        float p99 = bounds.bottom() - ((float)std::clamp(mStats.p99, min, max) - min) * sy;
+                        canvas->drawLine(bounds.left(), p99, bounds.right(), p99, mP99Paint);
+                    }
+
+                private:
+                    void append(uint32_t sample) {
+                        if (mNextSeq >= REBASE_AT) {
+                            rebase();
+                        }
+                        SkPoint point = SkPoint::Make((float)mNextSeq, (float)sample);
+                        mPoints[mWrite] = point;
+                        mPoints[mWrite + mHistory] = point;
+                        mWrite = (mWrite + 1 == mHistory) ? 0 : mWrite + 1;
+
+                        if (mNextSeq + 1 > mHistory) {
+                            mMinWindow.expire(mNextSeq + 1 - mHistory);
+                            mMaxWindow.expire(mNextSeq + 1 - mHistory);
+                        }
+                        mMinWindow.push(mNextSeq, sample);
+                        mMaxWindow.push(mNextSeq, sample);
+                        mNextSeq++;
+                    }
+
+                    // keep x coordinates small enough to be exact in float
+                    void rebase() {
+                        uint64_t base = mNextSeq - mHistory;
+                        for (auto& point : mPoints) {
+                            point.fX -= (float)base;
+                        }
+                        mMinWindow.rebase(base);
+                        mMaxWindow.rebase(base);
+                        mNextSeq -= base;
+                    }
+
+                    static constexpr uint64_t REBASE_AT = 1 << 22;
+
+                    const SharedPerfBuffer* mSource;
+                    size_t mHistory;
+                    std::vector<SkPoint> mPoints; // ring of mHistory points, mirrored
+                    std::vector<uint32_t> mScratch;
+                    MonotonicWindow<std::less<uint32_t>> mMinWindow;
+                    MonotonicWindow<std::greater<uint32_t>> mMaxWindow;
+                    SkPaint mLinePaint;
+                    SkPaint mP99Paint;
+                    PerfStats mStats;
+                    uint64_t mCursor = 0;
+                    uint64_t mNextSeq = 0;
+                    size_t mWrite = 0; // next slot to write, also the oldest visible point
+            };
+
+            SkRect mBounds;
+            size_t mHistory;
+            std::vector<std::unique_ptr<Series>> mSeries;
+    };
+}
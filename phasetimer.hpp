@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+
+namespace perf
+{
+    // Wall-clock time of consecutive phases, e.g. the init steps of the app.
+    // mark() closes the phase that started at the previous mark (or construction).
+    class PhaseTimer
+    {
+        public:
+            PhaseTimer() : mStart(std::chrono::steady_clock::now()), mLast(mStart) {
+                mPhases.reserve(16);
+            }
+
+            // name must outlive the timer, string literals are fine
+            void mark(const char* name) {
+                auto now = std::chrono::steady_clock::now();
+                mPhases.push_back({name, std::chrono::duration<double, std::milli>(now - mLast).count()});
+                mLast = now;
+            }
+
+            double getTotalMs() const { return std::chrono::duration<double, std::milli>(mLast - mStart).count(); }
+
+            void print(FILE* out) const {
+                double total = getTotalMs();
+                fprintf(out, "%-20s %10s %6s\n", "phase", "ms", "%");
+                for (const auto& phase : mPhases) {
+                    fprintf(out, "%-20s %10.2f %6.1f\n", phase.name, phase.ms, total > 0.0 ? 100.0 * phase.ms / total : 0.0);
+                }
+                fprintf(out, "%-20s %10.2f\n", "total", total);
+            }
+
+        private:
+            struct Phase
+            {
+                const char* name;
+                double ms;
+            };
+
+            std::chrono::steady_clock::time_point mStart;
+            std::chrono::steady_clock::time_point mLast;
+            std::vector<Phase> mPhases;
+    };
+}
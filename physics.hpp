@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <chrono>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace sim
+{
+    // smallest root of a*t^2 + b*t + c = 0 in (0, max_t], if any
+    std::optional<double> inline solve_quadratic(double a, double b, double c, double max_t) {
+        double disc = b * b - 4 * a * c;
+        if (disc < 0) {
+            return std::nullopt; // No real roots
+        }
+        double sqrt_d = std::sqrt(disc);
+        double denom = 2 * a;
+        double t1 = (-b - sqrt_d) / denom;
+        double t2 = (-b + sqrt_d) / denom;
+        double hit_t = std::numeric_limits<double>::infinity();
+        if (t1 > 0 && t1 <= max_t) hit_t = t1;
+        if (t2 > 0 && t2 <= max_t && t2 < hit_t) hit_t = t2;
+        if (hit_t == std::numeric_limits<double>::infinity()) {
+            return std::nullopt; // No valid positive roots in [0, max_t]
+        }
+        return hit_t;
+    }
+
+    struct WorldParams
+    {
+        double gravity = 9.81;
+        double top = 0.0;    // ball centers bounce at y = top
+        double floor = 5.0;  // ball edges bounce at y = floor
+        double left = 0.0;   // ball edges bounce at x = left and x = right
+        double right = 6.4;
+        double radius = 0.5;
+    };
+
+    // Structure-of-arrays ball storage, one entry per body in each array.
+    struct BallStore
+    {
+        std::vector<double> posX;
+        std::vector<double> posY;
+        std::vector<double> velX;
+        std::vector<double> velY;
+
+        size_t size() const { return posY.size(); }
+
+        void resize(size_t count) {
+            posX.resize(count, 0.0);
+            posY.resize(count, 0.0);
+            velX.resize(count, 0.0);
+            velY.resize(count, 0.0);
+        }
+    };
+
+    // Render-side copy of the ball state after one fixed physics tick. Holds the
+    // positions before and after the tick so the renderer can interpolate.
+    struct BallSnapshot
+    {
+        std::vector<float> prevX;
+        std::vector<float> posX;
+        std::vector<float> prevY;
+        std::vector<float> posY;
+        std::vector<float> velY;
+        std::chrono::steady_clock::time_point tickTime; // when posY became current
+        double stepDt = 0.0;
+        uint64_t tick = 0;
+        uint64_t lastMoveTick = 0; // newest tick in which any ball moved
+
+        void resize(size_t count) {
+            prevX.resize(count, 0.0f);
+            posX.resize(count, 0.0f);
+            prevY.resize(count, 0.0f);
+            posY.resize(count, 0.0f);
+            velY.resize(count, 0.0f);
+        }
+
+        size_t size() const { return posY.size(); }
+
+        // blend factor for drawing one tick behind 'now', clamped to [0, 1]
+        float interpolationAlpha(std::chrono::steady_clock::time_point now) const {
+            if (stepDt <= 0.0) {
+                return 1.0f;
+            }
+            double alpha = std::chrono::duration<double>(now - tickTime).count() / stepDt;
+            return (float)std::clamp(alpha, 0.0, 1.0);
+        }
+    };
+
+    // Reference integrator: exact parabolic motion with at most one elastic bounce per step
+    // and axis. Horizontal motion is linear, a wall hit mirrors the overshoot back.
+    inline void stepScalar(BallStore& balls, const WorldParams& world, double dt, size_t begin, size_t end) {
+        const double a = world.gravity;
+        const double aa = 0.5 * a;
+        const double ymax = world.floor - world.radius; // adjust bounce point by radius of the circle
+        const double xmin = world.left + world.radius;
+        const double xmax = world.right - world.radius;
+
+        for (size_t c = begin; c < end; ++c) {
+            double x = balls.posX[c] + balls.velX[c] * dt;
+            if (x < xmin) {
+                x = 2 * xmin - x;
+                balls.velX[c] = -balls.velX[c];
+            } else if (x > xmax) {
+                x = 2 * xmax - x;
+                balls.velX[c] = -balls.velX[c];
+            }
+            balls.posX[c] = x;
+
+            double y = balls.posY[c];
+            double v = balls.velY[c];
+
+            // Check for collision within dt
+            double hit_t = std::numeric_limits<double>::infinity();
+
+            // Collision with bottom (y = ymax, so y(t) = y + v*t + aa*t^2 = ymax)
+            auto t_bottom = solve_quadratic(aa, v, y - ymax, dt);
+            if (t_bottom && *t_bottom < hit_t) hit_t = *t_bottom;
+
+            // Collision with top (y = top, so y(t) = y + v*t + aa*t^2 = top)
+            auto t_top = solve_quadratic(aa, v, y - world.top, dt);
+            if (t_top && *t_top < hit_t) hit_t = *t_top;
+
+            if (hit_t <= dt) {
+                // Collision detected: advance to hit time, bounce, then advance remaining time
+                double y_hit = y + v * hit_t + aa * hit_t * hit_t;
+                double v_hit = v + a * hit_t;
+                double v_new = -v_hit; // Elastic bounce
+                double t_rem = dt - hit_t;
+                balls.posY[c] = y_hit + v_new * t_rem + aa * t_rem * t_rem;
+                balls.velY[c] = v_new + a * t_rem;
+            } else {
+                // No collision: standard parabolic update
+                balls.posY[c] = y + v * dt + aa * dt * dt; // y(t) = y + v*t + 0.5*a*t^2
+                balls.velY[c] = v + a * dt; // v(t) = v + a*t
+            }
+        }
+    }
+
+#ifdef __AVX2__
+    // Four bodies per iteration, branch-free. Both collision quadratics are solved
+    // for every lane and the results are selected with masks; lanes without a hit
+    // use hit_t = dt and skip the velocity flip, which reduces to the plain update.
+    inline void stepAVX2(BallStore& balls, const WorldParams& world, double dt, size_t begin, size_t end) {
+        const double a = world.gravity;
+        const double aa = 0.5 * a;
+
+        const __m256d vA = _mm256_set1_pd(a);
+        const __m256d vAA = _mm256_set1_pd(aa);
+        const __m256d vFourAA = _mm256_set1_pd(4.0 * aa);
+        const __m256d vInvDenom = _mm256_set1_pd(1.0 / (2.0 * aa));
+        const __m256d vDt = _mm256_set1_pd(dt);
+        const __m256d vYMax = _mm256_set1_pd(world.floor - world.radius);
+        const __m256d vTop = _mm256_set1_pd(world.top);
+        const __m256d vZero = _mm256_setzero_pd();
+        const __m256d vInf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+        const __m256d vSignBit = _mm256_set1_pd(-0.0);
+        const __m256d vXMin = _mm256_set1_pd(world.left + world.radius);
+        const __m256d vXMax = _mm256_set1_pd(world.right - world.radius);
+        const __m256d vTwo = _mm256_set1_pd(2.0);
+
+        // smallest root in (0, dt] or +inf, see solve_quadratic
+        auto solve = [&](__m256d b, __m256d c) {
+            __m256d disc = _mm256_fnmadd_pd(vFourAA, c, _mm256_mul_pd(b, b));
+            __m256d real = _mm256_cmp_pd(disc, vZero, _CMP_GE_OQ);
+            __m256d sqrtD = _mm256_sqrt_pd(_mm256_max_pd(disc, vZero));
+            __m256d negB = _mm256_xor_pd(b, vSignBit);
+            __m256d t1 = _mm256_mul_pd(_mm256_sub_pd(negB, sqrtD), vInvDenom);
+            __m256d t2 = _mm256_mul_pd(_mm256_add_pd(negB, sqrtD), vInvDenom);
+            __m256d ok1 = _mm256_and_pd(real, _mm256_and_pd(_mm256_cmp_pd(t1, vZero, _CMP_GT_OQ), _mm256_cmp_pd(t1, vDt, _CMP_LE_OQ)));
+            __m256d ok2 = _mm256_and_pd(real, _mm256_and_pd(_mm256_cmp_pd(t2, vZero, _CMP_GT_OQ), _mm256_cmp_pd(t2, vDt, _CMP_LE_OQ)));
+            // t1 <= t2 because the leading coefficient is positive
+            __m256d hit = _mm256_blendv_pd(vInf, t2, ok2);
+            return _mm256_blendv_pd(hit, t1, ok1);
+        };
+
+        size_t c = begin;
+        for (; c + 4 <= end; c += 4) {
+            // horizontal: linear move, mirror the overshoot at the walls
+            __m256d vx = _mm256_loadu_pd(&balls.velX[c]);
+            __m256d x = _mm256_fmadd_pd(vx, vDt, _mm256_loadu_pd(&balls.posX[c]));
+            __m256d hitLeft = _mm256_cmp_pd(x, vXMin, _CMP_LT_OQ);
+            __m256d hitRight = _mm256_cmp_pd(x, vXMax, _CMP_GT_OQ);
+            __m256d wall = _mm256_blendv_pd(vXMax, vXMin, hitLeft);
+            __m256d hitWall = _mm256_or_pd(hitLeft, hitRight);
+            x = _mm256_blendv_pd(x, _mm256_fmsub_pd(vTwo, wall, x), hitWall);
+            vx = _mm256_blendv_pd(vx, _mm256_xor_pd(vx, vSignBit), hitWall);
+            _mm256_storeu_pd(&balls.posX[c], x);
+            _mm256_storeu_pd(&balls.velX[c], vx);
+
+            __m256d y = _mm256_loadu_pd(&balls.posY[c]);
+            __m256d v = _mm256_loadu_pd(&balls.velY[c]);
+
+            __m256d hitBottom = solve(v, _mm256_sub_pd(y, vYMax));
+            __m256d hitTop = solve(v, _mm256_sub_pd(y, vTop));
+            __m256d hitT = _mm256_min_pd(hitBottom, hitTop);
+            __m256d collided = _mm256_cmp_pd(hitT, vDt, _CMP_LE_OQ);
+            hitT = _mm256_blendv_pd(vDt, hitT, collided);
+
+            // advance to the hit time (or the full step)
+            __m256d yHit = _mm256_fmadd_pd(_mm256_mul_pd(vAA, hitT), hitT, _mm256_fmadd_pd(v, hitT, y));
+            __m256d vHit = _mm256_fmadd_pd(vA, hitT, v);
+
+            // elastic bounce and the remaining time, zero for lanes without a hit
+            __m256d vNew = _mm256_blendv_pd(vHit, _mm256_xor_pd(vHit, vSignBit), collided);
+            __m256d tRem = _mm256_sub_pd(vDt, hitT);
+            __m256d yOut = _mm256_fmadd_pd(_mm256_mul_pd(vAA, tRem), tRem, _mm256_fmadd_pd(vNew, tRem, yHit));
+            __m256d vOut = _mm256_fmadd_pd(vA, tRem, vNew);
+
+            _mm256_storeu_pd(&balls.posY[c], yOut);
+            _mm256_storeu_pd(&balls.velY[c], vOut);
+        }
+
+        // remainder
+        stepScalar(balls, world, dt, c, end);
+    }
+#endif
+
+    inline void step(BallStore& balls, const WorldParams& world, double dt, size_t begin, size_t end) {
+#ifdef __AVX2__
+        stepAVX2(balls, world, dt, begin, end);
+#else
+        stepScalar(balls, world, dt, begin, end);
+#endif
+    }
+
+    inline void step(BallStore& balls, const WorldParams& world, double dt) {
+        step(balls, world, dt, 0, balls.size());
+    }
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace sim
+{
+    // Blocking FIFO with a fixed capacity: push() waits while it is full, pop() waits
+    // while it is empty. After close() pushes fail and pops drain what is left.
+    // Items live in a ring of capacity slots allocated up front, so passing items
+    // through never allocates.
+    template<typename T>
+    class BoundedQueue
+    {
+        public:
+            explicit BoundedQueue(size_t capacity) : mCapacity(capacity), mItems(capacity) {}
+
+            bool push(T item) {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mNotFull.wait(lock, [this]() { return mClosed || mCount < mCapacity; });
+                if (mClosed) {
+                    return false;
+                }
+                mItems[(mHead + mCount) % mCapacity] = std::move(item);
+                mCount++;
+                lock.unlock();
+                mNotEmpty.notify_one();
+                return true;
+            }
+
+            bool pop(T& out) {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mNotEmpty.wait(lock, [this]() { return mClosed || mCount > 0; });
+                if (mCount == 0) {
+                    return false;
+                }
+                out = std::move(mItems[mHead]);
+                mHead = (mHead + 1 == mCapacity) ? 0 : mHead + 1;
+                mCount--;
+                lock.unlock();
+                mNotFull.notify_one();
+                return true;
+            }
+
+            void close() {
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mClosed = true;
+                }
+                mNotFull.notify_all();
+                mNotEmpty.notify_all();
+            }
+
+        private:
+            size_t mCapacity;
+            std::vector<T> mItems;
+            size_t mHead = 0; // oldest item
+            size_t mCount = 0;
+            std::mutex mMutex;
+            std::condition_variable mNotFull;
+            std::condition_variable mNotEmpty;
+            bool mClosed = false;
+    };
+
+    // Produces a numbered stream of items on worker threads and hands them to one
+    // consumer in order. Worker w makes items w, w + N, w + 2N, ... and pushes them to
+    // its own bounded queue, so the consumer reads frame f from queue f % N and never
+    // has to reorder; the queue depth bounds how far the workers run ahead.
+    // Producing is split in two: latch(worker, frame) runs strictly in frame order
+    // across all workers (for sampling shared state), make(worker, frame) runs in
+    // parallel and returns the item. The optional start(worker) runs once on each
+    // worker thread before its first item, e.g. to name the thread.
+    template<typename Item>
+    class OrderedPipeline
+    {
+        public:
+            template<typename Latch, typename Make>
+            OrderedPipeline(size_t workerCount, size_t depth, Latch latch, Make make)
+                : OrderedPipeline(workerCount, depth, [](size_t) {}, latch, make) {}
+
+            template<typename Start, typename Latch, typename Make>
+            OrderedPipeline(size_t workerCount, size_t depth, Start start, Latch latch, Make make) {
+                workerCount = std::max<size_t>(workerCount, 1);
+                for (size_t w = 0; w < workerCount; ++w) {
+                    mQueues.push_back(std::make_unique<BoundedQueue<Item>>(std::max<size_t>(depth, 1)));
+                }
+                for (size_t w = 0; w < workerCount; ++w) {
+                    mWorkers.emplace_back([this, w, workerCount, start, latch, make]() {
+                        start(w);
+                        for (uint64_t frame = w; ; frame += workerCount) {
+                            if (!waitTurn(frame)) {
+                                return;
+                            }
+                            latch(w, frame);
+                            endTurn();
+                            if (!mQueues[w]->push(make(w, frame))) {
+                                return;
+                            }
+                        }
+                    });
+                }
+            }
+
+            ~OrderedPipeline() {
+                stop();
+            }
+
+            // consumer; false once stopped
+            bool next(Item& out) {
+                if (!mQueues[mNextFrame % mQueues.size()]->pop(out)) {
+                    return false;
+                }
+                mNextFrame++;
+                return true;
+            }
+
+            void stop() {
+                {
+                    std::lock_guard<std::mutex> lock(mTurnMutex);
+                    mStopped = true;
+                }
+                mTurnChanged.notify_all();
+                for (auto& queue : mQueues) {
+                    queue->close();
+                }
+                for (auto& worker : mWorkers) {
+                    if (worker.joinable()) {
+                        worker.join();
+                    }
+                }
+            }
+
+        private:
+            bool waitTurn(uint64_t frame) {
+                std::unique_lock<std::mutex> lock(mTurnMutex);
+                mTurnChanged.wait(lock, [&]() { return mStopped || mTurn == frame; });
+                return !mStopped;
+            }
+
+            void endTurn() {
+                {
+                    std::lock_guard<std::mutex> lock(mTurnMutex);
+                    mTurn++;
+                }
+                mTurnChanged.notify_all();
+            }
+
+            std::vector<std::unique_ptr<BoundedQueue<Item>>> mQueues;
+            std::vector<std::thread> mWorkers;
+            uint64_t mNextFrame = 0;
+
+            std::mutex mTurnMutex;
+            std::condition_variable mTurnChanged;
+            uint64_t mTurn = 0;
+            bool mStopped = false;
+    };
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <filesystem>
+#include <vulkan/vulkan.h>
+
+#include "include/core/SkData.h"
+#include "include/core/SkStream.h"
+#include "include/gpu/graphite/PersistentPipelineStorage.h"
+
+namespace perf
+{
+    // Graphite pipeline data kept in one file per driver and device, so a launch can
+    // load the pipelines the previous one compiled instead of compiling them again on
+    // the first frames. Stores go to a temporary file that is renamed over the old one,
+    // so a crash mid-write never leaves a truncated cache behind.
+    class FilePipelineStorage : public skgpu::graphite::PersistentPipelineStorage
+    {
+        public:
+            explicit FilePipelineStorage(std::string path) : mPath(std::move(path)) {}
+
+            // <dir>/pipelines-<vendor>-<device>-<driver>-<cache uuid>.bin; a driver update
+            // changes the name, so stale data is never handed to a different driver
+            static std::string pathFor(const std::string& dir, const VkPhysicalDeviceProperties& properties) {
+                char name[128];
+                int len = snprintf(name, sizeof(name), "pipelines-%04x-%04x-%08x-", properties.vendorID, properties.deviceID, properties.driverVersion);
+                for (uint8_t byte : properties.pipelineCacheUUID) {
+                    len += snprintf(name + len, sizeof(name) - len, "%02x", byte);
+                }
+                return dir + "/" + name + ".bin";
+            }
+
+            // $XDG_CACHE_HOME/skiavr or ~/.cache/skiavr
+            static std::string defaultDir() {
+                if (const char* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+                    return std::string(xdg) + "/skiavr";
+                }
+                const char* home = getenv("HOME");
+                return std::string(home ? home : ".") + "/.cache/skiavr";
+            }
+
+            const std::string& getPath() const { return mPath; }
+            size_t getLoadedSize() const { return mLoadedSize; }
+
+            sk_sp<SkData> load() override {
+                sk_sp<SkData> data = SkData::MakeFromFileName(mPath.c_str());
+                mLoadedSize = data ? data->size() : 0;
+                return data;
+            }
+
+            void store(const SkData& data) override {
+                std::error_code error;
+                std::filesystem::create_directories(std::filesystem::path(mPath).parent_path(), error);
+
+                std::string tmpPath = mPath + ".tmp";
+                {
+                    SkFILEWStream stream(tmpPath.c_str());
+                    if (!stream.isValid() || !stream.write(data.data(), data.size())) {
+                        fprintf(stderr, "Failed to write pipeline cache %s\n", tmpPath.c_str());
+                        return;
+                    }
+                }
+                if (rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+                    fprintf(stderr, "Failed to replace pipeline cache %s\n", mPath.c_str());
+                }
+            }
+
+        private:
+            std::string mPath;
+            size_t mLoadedSize = 0;
+    };
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include "perfbuffer.hpp"
+
+namespace perf
+{
+    // Picks a render scale that holds the draw time under a target.
+    // Fill cost grows with the pixel count, so the scale is corrected by
+    // sqrt(target / p95). Going down reacts to a full window over budget; going up
+    // only happens in small steps once p95 has stayed below UP_THRESHOLD of the
+    // target. Between the two thresholds nothing changes, and after every change
+    // the window is refilled with samples at the new scale before the next decision.
+    // Together this keeps the scale from oscillating around the target.
+    class ResolutionController
+    {
+        public:
+            ResolutionController(uint32_t targetUs, float minScale = 0.5f, float maxScale = 1.0f, size_t window = 60)
+                : mTargetUs(targetUs), mMinScale(minScale), mMaxScale(maxScale), mScale(maxScale), mRecent(window) {}
+
+            // one frame's draw time at the current scale; returns true when the scale changed
+            bool addSample(uint32_t drawUs) {
+                mRecent.addSample(drawUs);
+                if (++mFramesAtScale < mRecent.getSize() || mTargetUs == 0) {
+                    return false;
+                }
+
+                double p95 = mRecent.getPercentile(95.0);
+                float scale = mScale;
+                if (p95 > mTargetUs) {
+                    scale = mScale * (float)std::sqrt(mTargetUs / p95) * DOWN_HEADROOM;
+                }
+                else if (p95 < mTargetUs * UP_THRESHOLD) {
+                    scale = mScale + UP_STEP;
+                }
+                scale = std::clamp(scale, mMinScale, mMaxScale);
+                if (std::abs(scale - mScale) < 0.01f) {
+                    return false;
+                }
+
+                mScale = scale;
+                mFramesAtScale = 0;
+                return true;
+            }
+
+            float getScale() const { return mScale; }
+
+        private:
+            static constexpr float DOWN_HEADROOM = 0.95f;
+            static constexpr double UP_THRESHOLD = 0.7;
+            static constexpr float UP_STEP = 0.05f;
+
+            uint32_t mTargetUs;
+            float mMinScale;
+            float mMaxScale;
+            float mScale;
+            PerfBuffer mRecent;
+            size_t mFramesAtScale = 0;
+    };
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include <thread>
+#include "perfbuffer.hpp"
+
+namespace sim
+{
+    // Paces the render loop. VSYNC leaves the pacing to the blocking acquire and only
+    // measures; FIXED starts frames on a grid of deadlines one period apart; ON_DEMAND
+    // uses the same grid but skips the slots in which nothing changed.
+    // Sleeping is predictive: the OS wakes a thread late by a varying amount, so the
+    // scheduler sleeps until the deadline minus the p95 wake-up error of recent sleeps
+    // and yields away the rest. A frame that starts more than half a period after its
+    // deadline (in VSYNC: one that comes 1.5 periods after the previous) counts as
+    // missed, and the grid restarts from now instead of bursting to catch up.
+    // All calls except getStats() come from the render thread.
+    class FrameScheduler
+    {
+        public:
+            enum Mode { VSYNC, FIXED, ON_DEMAND };
+            using Clock = std::chrono::steady_clock;
+
+            struct Stats
+            {
+                uint64_t frames = 0;
+                uint64_t missed = 0;
+                uint64_t skipped = 0; // ON_DEMAND slots without a frame
+                uint32_t wakeErrorP50Us = 0;
+                uint32_t wakeErrorP99Us = 0;
+                double threadCpuPercent = 0.0; // render thread CPU time over wall time
+                double processCpuPercent = 0.0; // all threads, 100 per busy core
+            };
+
+            explicit FrameScheduler(Mode mode = VSYNC, double hz = 90.0) : mMode(mode), mWakeErrors(WAKE_HISTORY) {
+                setRate(hz);
+            }
+
+            void setRate(double hz) {
+                mPeriod = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+            }
+
+            Mode getMode() const { return mMode; }
+
+            // frames started so far, the current one included
+            uint64_t getFrameCount() const { return mFrames; }
+
+            // Blocks until the next frame should start. changed() is asked once per ON_DEMAND
+            // slot whether there is anything new to draw. Returns false once run is cleared.
+            template<typename Changed>
+            bool waitForFrame(const std::atomic<bool>& run, Changed changed) {
+                auto now = Clock::now();
+                if (mFrames == 0) {
+                    mStartWall = now;
+                    mStartThreadCpu = cpuTime(CLOCK_THREAD_CPUTIME_ID);
+                    mStartProcessCpu = cpuTime(CLOCK_PROCESS_CPUTIME_ID);
+                    mNext = now;
+                }
+
+                if (mMode == VSYNC) {
+                    if (mFrames > 0 && now - mLastFrame > mPeriod * 3 / 2) {
+                        mMissed++;
+                    }
+                    frameStarted(now);
+                    return run;
+                }
+
+                if (now > mNext + mPeriod / 2) {
+                    mMissed++;
+                    mNext = now;
+                }
+                while (run) {
+                    sleepUntil(mNext);
+                    mNext += mPeriod;
+                    if (mMode != ON_DEMAND || changed()) {
+                        frameStarted(Clock::now());
+                        return true;
+                    }
+                    mSkipped++;
+                }
+                return false;
+            }
+
+            Stats getStats() const {
+                Stats stats;
+                stats.frames = mFrames;
+                stats.missed = mMissed;
+                stats.skipped = mSkipped;
+                stats.wakeErrorP50Us = mWakeErrors.getPercentile(50.0);
+                stats.wakeErrorP99Us = mWakeErrors.getPercentile(99.0);
+                double wall = std::chrono::duration<double>(mLastFrame - mStartWall).count();
+                if (wall > 0.0) {
+                    stats.threadCpuPercent = 100.0 * (mThreadCpu - mStartThreadCpu) / wall;
+                    stats.processCpuPercent = 100.0 * (mProcessCpu - mStartProcessCpu) / wall;
+                }
+                return stats;
+            }
+
+        private:
+            static constexpr size_t WAKE_HISTORY = 128;
+
+            static double cpuTime(clockid_t clock) {
+                timespec ts;
+                clock_gettime(clock, &ts);
+                return ts.tv_sec + ts.tv_nsec * 1e-9;
+            }
+
+            void sleepUntil(Clock::time_point deadline) {
+                auto target = deadline - std::chrono::microseconds(mWakeErrors.getPercentile(95.0));
+                if (target > Clock::now()) {
+                    std::this_thread::sleep_until(target);
+                    mWakeErrors.addSample((uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - target).count());
+                }
+                while (Clock::now() < deadline) {
+                    std::this_thread::yield();
+                }
+            }
+
+            void frameStarted(Clock::time_point now) {
+                mFrames++;
+                mLastFrame = now;
+                mThreadCpu = cpuTime(CLOCK_THREAD_CPUTIME_ID);
+                mProcessCpu = cpuTime(CLOCK_PROCESS_CPUTIME_ID);
+            }
+
+            Mode mMode;
+            Clock::duration mPeriod;
+            Clock::time_point mNext;
+            Clock::time_point mLastFrame;
+            perf::PerfBuffer mWakeErrors;
+
+            uint64_t mFrames = 0;
+            uint64_t mMissed = 0;
+            uint64_t mSkipped = 0;
+
+            Clock::time_point mStartWall;
+            double mStartThreadCpu = 0.0;
+            double mStartProcessCpu = 0.0;
+            double mThreadCpu = 0.0;
+            double mProcessCpu = 0.0;
+    };
+}
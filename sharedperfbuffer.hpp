@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "perfbuffer.hpp"
+
+namespace perf
+{
+    struct PerfStats
+    {
+        uint32_t min = 0;
+        uint32_t max = 0;
+        uint32_t p50 = 0;
+        uint32_t p95 = 0;
+        uint32_t p99 = 0;
+        uint32_t p999 = 0;
+        uint64_t sampleCount = 0;
+    };
+
+    struct PerfSnapshot
+    {
+        std::vector<uint32_t> samples; // oldest first, sized to the window
+        PerfStats stats;
+    };
+
+    // Single-producer / multi-consumer PerfBuffer.
+    // The producer thread calls addSample() and never blocks or waits. Readers on any
+    // thread take consistent copies of the window and its statistics through a seqlock:
+    // the producer bumps mVersion to odd before and to even after each update, readers
+    // retry when the version changed while they were copying. All shared words are
+    // atomics and no standalone fences are used, so ThreadSanitizer understands it.
+    class SharedPerfBuffer
+    {
+        public:
+            SharedPerfBuffer(size_t size) : mSize(size), mLocal(size), mRing(new std::atomic<uint32_t>[size]) {
+                for (size_t i = 0; i < mSize; ++i) {
+                    mRing[i].store(0, std::memory_order_relaxed);
+                }
+            }
+
+            // producer thread only
+            void addSample(uint32_t sample) {
+                mLocal.addSample(sample);
+
+                static constexpr double percentiles[] = {50.0, 95.0, 99.0, 99.9};
+                uint32_t p[4];
+                mLocal.getPercentiles(percentiles, p, 4);
+
+                uint64_t count = mCount.load(std::memory_order_relaxed);
+                uint64_t version = mVersion.load(std::memory_order_relaxed);
+                mVersion.store(version + 1, std::memory_order_relaxed);
+
+                // release stores keep the odd version ordered before the data
+                mRing[count % mSize].store(sample, std::memory_order_release);
+                mStats[MIN].store(mLocal.getMin(), std::memory_order_release);
+                mStats[MAX].store(mLocal.getMax(), std::memory_order_release);
+                mStats[P50].store(p[0], std::memory_order_release);
+                mStats[P95].store(p[1], std::memory_order_release);
+                mStats[P99].store(p[2], std::memory_order_release);
+                mStats[P999].store(p[3], std::memory_order_release);
+                mCount.store(count + 1, std::memory_order_release);
+
+                mVersion.store(version + 2, std::memory_order_release);
+            }
+
+            // any thread; single attempt, returns false if the producer raced us
+            bool tryGetStats(PerfStats& out) const {
+                uint64_t before = mVersion.load(std::memory_order_acquire);
+                if (before & 1) {
+                    return false;
+                }
+                readStats(out);
+                return mVersion.load(std::memory_order_relaxed) == before;
+            }
+
+            PerfStats getStats() const {
+                PerfStats stats;
+                while (!tryGetStats(stats)) {
+                    std::this_thread::yield();
+                }
+                return stats;
+            }
+
+            // any thread; copies the whole window (oldest first) together with matching stats
+            bool trySnapshot(PerfSnapshot& out) const {
+                out.samples.resize(mSize);
+                uint64_t before = mVersion.load(std::memory_order_acquire);
+                if (before & 1) {
+                    return false;
+                }
+                readStats(out.stats);
+                uint64_t next = out.stats.sampleCount % mSize; // slot of the oldest sample
+                for (size_t i = 0; i < mSize; ++i) {
+                    out.samples[i] = mRing[next].load(std::memory_order_acquire);
+                    next = (next + 1 == mSize) ? 0 : next + 1;
+                }
+                return mVersion.load(std::memory_order_relaxed) == before;
+            }
+
+            void snapshot(PerfSnapshot& out) const {
+                while (!trySnapshot(out)) {
+                    std::this_thread::yield();
+                }
+            }
+
+            // any thread; copies the samples published since 'cursor' (oldest first, at most
+            // capacity of the newest ones) with matching stats and advances the cursor.
+            // Costs O(new samples), so a reader polling every frame only pays for what changed.
+            // A retry yields first: the producer may have been preempted mid-update, and
+            // spinning on its core would only keep it from finishing.
+            size_t readSince(uint64_t& cursor, uint32_t* out, size_t capacity, PerfStats& stats) const {
+                for (;; std::this_thread::yield()) {
+                    uint64_t before = mVersion.load(std::memory_order_acquire);
+                    if (before & 1) {
+                        continue;
+                    }
+                    readStats(stats);
+                    uint64_t count = stats.sampleCount;
+                    uint64_t first = std::max(cursor, count - std::min<uint64_t>(count, std::min(capacity, mSize)));
+                    size_t n = (size_t)(count - first);
+                    for (size_t i = 0; i < n; ++i) {
+                        out[i] = mRing[(first + i) % mSize].load(std::memory_order_acquire);
+                    }
+                    if (mVersion.load(std::memory_order_relaxed) == before) {
+                        cursor = count;
+                        return n;
+                    }
+                }
+            }
+
+            uint64_t getSampleCount() const { return mCount.load(std::memory_order_acquire); }
+            size_t getSize() const { return mSize; }
+
+        private:
+            enum StatIndex { MIN, MAX, P50, P95, P99, P999, STAT_COUNT };
+
+            void readStats(PerfStats& out) const {
+                // acquire loads keep the closing version check ordered after the data
+                out.min = mStats[MIN].load(std::memory_order_acquire);
+                out.max = mStats[MAX].load(std::memory_order_acquire);
+                out.p50 = mStats[P50].load(std::memory_order_acquire);
+                out.p95 = mStats[P95].load(std::memory_order_acquire);
+                out.p99 = mStats[P99].load(std::memory_order_acquire);
+                out.p999 = mStats[P999].load(std::memory_order_acquire);
+                out.sampleCount = mCount.load(std::memory_order_acquire);
+            }
+
+            size_t mSize;
+            PerfBuffer mLocal; // producer-side min/max/histogram engine
+            std::unique_ptr<std::atomic<uint32_t>[]> mRing;
+            std::atomic<uint32_t> mStats[STAT_COUNT] = {};
+            std::atomic<uint64_t> mCount = 0;
+            std::atomic<uint64_t> mVersion = 0;
+    };
+}
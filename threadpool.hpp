@@ -0,0 +1,223 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace sim
+{
+    // Fixed set of worker threads running chunked parallel-for loops with work stealing.
+    //
+    // A range is cut into chunks and every participant (the workers plus the calling
+    // thread) owns one contiguous block of chunks, so each core keeps touching the same
+    // part of the SoA arrays from step to step. Owners pop chunks from the front of
+    // their block; idle participants steal from the back of other blocks. A block is
+    // a single atomic word (head | tail << 32) so popping and stealing are one CAS each.
+    // Starting and finishing a loop takes one short mutex handoff, chunk distribution
+    // is lock-free.
+    class WorkStealingPool
+    {
+        public:
+            // threadCount includes the calling thread
+            explicit WorkStealingPool(size_t threadCount = std::thread::hardware_concurrency(), bool pinThreads = false)
+                : mThreadCount(std::max<size_t>(threadCount, 1)), mBlocks(new Block[mThreadCount]) {
+                for (size_t i = 1; i < mThreadCount; ++i) {
+                    mThreads.emplace_back([this, i]() { workerLoop(i); });
+                }
+                if (pinThreads) {
+                    for (size_t i = 0; i < mThreads.size(); ++i) {
+                        pinToCore(mThreads[i], i + 1);
+                    }
+                }
+            }
+
+            ~WorkStealingPool() {
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mStop = true;
+                }
+                mWakeup.notify_all();
+                for (auto& t : mThreads) {
+                    t.join();
+                }
+            }
+
+            size_t getThreadCount() const { return mThreadCount; }
+            uint64_t getStealCount() const { return mSteals.load(std::memory_order_relaxed); }
+
+            // Calls fn(chunkBegin, chunkEnd) for chunks of [begin, end) on all threads and
+            // returns once every chunk ran. Chunk sizes are rounded up to 8 elements so
+            // chunks of double arrays never share a cache line.
+            template<typename F>
+            void parallelFor(size_t begin, size_t end, size_t grain, F&& fn) {
+                if (end <= begin) {
+                    return;
+                }
+                size_t count = end - begin;
+                grain = std::max<size_t>((grain + 7) & ~size_t(7), 8);
+                if (mThreadCount == 1 || count <= grain) {
+                    fn(begin, end);
+                    return;
+                }
+
+                size_t chunkCount = (count + grain - 1) / grain;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    // workers still leaving the previous loop may read the job description
+                    mIdle.wait(lock, [this]() { return mActive == 0; });
+
+                    mJob.invoke = [](void* context, size_t b, size_t e) { (*static_cast<F*>(context))(b, e); };
+                    mJob.context = &fn;
+                    mJob.begin = begin;
+                    mJob.end = end;
+                    mJob.chunkSize = grain;
+                    for (size_t i = 0; i < mThreadCount; ++i) {
+                        uint64_t head = chunkCount * i / mThreadCount;
+                        uint64_t tail = chunkCount * (i + 1) / mThreadCount;
+                        mBlocks[i].range.store(head | (tail << 32), std::memory_order_relaxed);
+                    }
+                    mRemaining.store(chunkCount, std::memory_order_relaxed);
+                    mEpoch++;
+                }
+                mWakeup.notify_all();
+
+                Job job = mJob;
+                runChunks(0, job);
+                while (mRemaining.load(std::memory_order_acquire) != 0) {
+                    std::this_thread::yield();
+                }
+            }
+
+        private:
+            struct Job
+            {
+                void (*invoke)(void*, size_t, size_t) = nullptr;
+                void* context = nullptr;
+                size_t begin = 0;
+                size_t end = 0;
+                size_t chunkSize = 0;
+            };
+
+            struct alignas(64) Block
+            {
+                std::atomic<uint64_t> range = 0; // head | tail << 32, chunk indices
+            };
+
+            static bool popFront(Block& block, uint32_t& chunk) {
+                uint64_t range = block.range.load(std::memory_order_relaxed);
+                while (true) {
+                    uint32_t head = (uint32_t)range;
+                    uint32_t tail = (uint32_t)(range >> 32);
+                    if (head >= tail) {
+                        return false;
+                    }
+                    uint64_t next = (uint64_t)(head + 1) | ((uint64_t)tail << 32);
+                    if (block.range.compare_exchange_weak(range, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                        chunk = head;
+                        return true;
+                    }
+                }
+            }
+
+            static bool popBack(Block& block, uint32_t& chunk) {
+                uint64_t range = block.range.load(std::memory_order_relaxed);
+                while (true) {
+                    uint32_t head = (uint32_t)range;
+                    uint32_t tail = (uint32_t)(range >> 32);
+                    if (head >= tail) {
+                        return false;
+                    }
+                    uint64_t next = (uint64_t)head | ((uint64_t)(tail - 1) << 32);
+                    if (block.range.compare_exchange_weak(range, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                        chunk = tail - 1;
+                        return true;
+                    }
+                }
+            }
+
+            void runChunk(const Job& job, uint32_t chunk) {
+                size_t b = job.begin + (size_t)chunk * job.chunkSize;
+                size_t e = std::min(b + job.chunkSize, job.end);
+                job.invoke(job.context, b, e);
+                mRemaining.fetch_sub(1, std::memory_order_acq_rel);
+            }
+
+            void runChunks(size_t self, const Job& job) {
+                uint32_t chunk;
+                while (popFront(mBlocks[self], chunk)) {
+                    runChunk(job, chunk);
+                }
+                // own block drained, steal from the others
+                for (size_t n = 1; n < mThreadCount; ++n) {
+                    Block& victim = mBlocks[(self + n) % mThreadCount];
+                    while (popBack(victim, chunk)) {
+                        mSteals.fetch_add(1, std::memory_order_relaxed);
+                        runChunk(job, chunk);
+                    }
+                }
+            }
+
+            void workerLoop(size_t self) {
+                uint64_t seenEpoch = 0;
+                while (true) {
+                    Job job;
+                    {
+                        std::unique_lock<std::mutex> lock(mMutex);
+                        mWakeup.wait(lock, [&]() { return mStop || mEpoch != seenEpoch; });
+                        if (mStop) {
+                            return;
+                        }
+                        seenEpoch = mEpoch;
+                        job = mJob;
+                        mActive++;
+                    }
+
+                    runChunks(self, job);
+
+                    {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        mActive--;
+                    }
+                    mIdle.notify_one();
+                }
+            }
+
+            static void pinToCore(std::thread& thread, size_t core) {
+#ifdef __linux__
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(core % std::max(1u, std::thread::hardware_concurrency()), &set);
+                pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+                (void)thread;
+                (void)core;
+#endif
+            }
+
+            size_t mThreadCount;
+            std::unique_ptr<Block[]> mBlocks;
+            std::vector<std::thread> mThreads;
+
+            std::mutex mMutex;
+            std::condition_variable mWakeup;
+            std::condition_variable mIdle;
+            Job mJob;
+            uint64_t mEpoch = 0;
+            size_t mActive = 0;
+            bool mStop = false;
+
+            std::atomic<size_t> mRemaining = 0;
+            std::atomic<uint64_t> mSteals = 0;
+    };
+}
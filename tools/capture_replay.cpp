@@ -0,0 +1,157 @@
+#include "../capture.hpp"
+#include "../perfbuffer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "include/codec/SkCodec.h"
+#include "include/codec/SkPngDecoder.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkData.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkImageInfo.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkPixmap.h"
+#include "include/core/SkSerialProcs.h"
+#include "include/core/SkStream.h"
+#include "include/core/SkSurface.h"
+#include "include/encode/SkPngEncoder.h"
+
+// Plays frames of a capture file (app --capture) into a CPU raster surface as fast
+// as possible, to profile Skia's draw cost of real frames without Vulkan or a
+// headset. Pictures are deserialized once up front and timed separately; playback
+// times per frame are reported as percentiles, together with the slowest frame.
+//
+// usage: capture_replay FILE [--from N] [--to M] [--repeat R] [--list] [--png-dir DIR]
+//   --from/--to  index range (inclusive) of the frames to play, default all
+//   --repeat     plays the range R times (default 10)
+//   --list       prints the index (app frame number, bytes, draw time in the app) and exits
+//   --png-dir    writes every frame of the first pass as DIR/replay_<index>.png
+
+static sk_sp<SkImage> deserializeImage(const void* data, size_t length, void*) {
+    return SkImages::DeferredFromEncodedData(SkData::MakeWithCopy(data, length));
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    size_t from = 0;
+    size_t to = SIZE_MAX;
+    int repeat = 10;
+    bool list = false;
+    const char* pngDir = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            from = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        }
+        else if (strcmp(argv[i], "--png-dir") == 0 && i + 1 < argc) {
+            pngDir = argv[++i];
+        }
+        else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s FILE [--from N] [--to M] [--repeat R] [--list] [--png-dir DIR]\n", argv[0]);
+        return -1;
+    }
+
+    perf::CaptureReader capture;
+    if (!capture.open(path)) {
+        return -1;
+    }
+    size_t frameCount = capture.getFrameCount();
+    if (list) {
+        printf("%8s %10s %12s %10s\n", "index", "frame", "bytes", "draw us");
+        for (size_t i = 0; i < frameCount; ++i) {
+            const perf::CaptureFrame& frame = capture.getFrame(i);
+            printf("%8zu %10llu %12llu %10u\n", i, (unsigned long long)frame.frame, (unsigned long long)frame.size, frame.drawUs);
+        }
+        return 0;
+    }
+    to = std::min(to, frameCount ? frameCount - 1 : 0);
+    if (frameCount == 0 || from > to) {
+        fprintf(stderr, "%s has %zu frames, nothing to play in %zu..%zu\n", path, frameCount, from, to);
+        return -1;
+    }
+
+    // the ball sprite is stored as PNG
+    SkCodecs::Register(SkPngDecoder::Decoder());
+    SkDeserialProcs procs;
+    procs.fImageProc = deserializeImage;
+
+    size_t count = to - from + 1;
+    std::vector<sk_sp<SkPicture>> pictures(count);
+    perf::PerfBuffer loadTimes(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        pictures[i] = SkPicture::MakeFromData(capture.getData(from + i), capture.getFrame(from + i).size, &procs);
+        loadTimes.addSample(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        if (!pictures[i]) {
+            fprintf(stderr, "Failed to deserialize frame %zu\n", from + i);
+            return -1;
+        }
+    }
+
+    sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(capture.getWidth(), capture.getHeight()));
+    if (!surface) {
+        fprintf(stderr, "Failed to create a %ux%u raster surface\n", capture.getWidth(), capture.getHeight());
+        return -1;
+    }
+    SkCanvas* canvas = surface->getCanvas();
+
+    perf::PerfBuffer playTimes(count * repeat);
+    uint32_t slowestUs = 0;
+    size_t slowest = from;
+    auto runStart = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < repeat; ++pass) {
+        for (size_t i = 0; i < count; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            canvas->drawPicture(pictures[i]);
+            uint32_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            playTimes.addSample(us);
+            if (us > slowestUs) {
+                slowestUs = us;
+                slowest = from + i;
+            }
+
+            if (pngDir && pass == 0) {
+                SkPixmap pixmap;
+                char file[4096];
+                snprintf(file, sizeof(file), "%s/replay_%05zu.png", pngDir, from + i);
+                SkFILEWStream stream(file);
+                if (!surface->peekPixels(&pixmap) || !stream.isValid() || !SkPngEncoder::Encode(&stream, pixmap, {})) {
+                    fprintf(stderr, "Failed to write %s\n", file);
+                    return -1;
+                }
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+    printf("replay: frames %zu..%zu of %zu, %d passes, %ux%u, %.1f frames/s%s\n", from, to, frameCount, repeat,
+           capture.getWidth(), capture.getHeight(), count * repeat / seconds, pngDir ? " (incl. PNG writes)" : "");
+    printf("%-12s %10s %10s %10s %10s\n", "phase", "p50 us", "p99 us", "min us", "max us");
+    auto report = [](const char* name, const perf::PerfBuffer& times) {
+        printf("%-12s %10u %10u %10u %10u\n", name, times.getPercentile(50.0), times.getPercentile(99.0), times.getMin(), times.getMax());
+    };
+    report("deserialize", loadTimes);
+    report("playback", playTimes);
+    printf("slowest playback: index %zu (app frame %llu, drawn in %u us there) at %u us\n", slowest,
+           (unsigned long long)capture.getFrame(slowest).frame, capture.getFrame(slowest).drawUs, slowestUs);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "../metricsshm.hpp"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Reads the metrics segment the app publishes with --metrics-shm and prints it, once
+// or every interval. The segment is mapped read-only and read through its seqlock,
+// so watching costs the renderer nothing. With --json every update is one JSON line;
+// --samples adds the samples published since the previous line.
+//
+// usage: metrics_cli [--name NAME] [--interval MS] [--count N] [--json] [--samples]
+
+static volatile sig_atomic_t running = 1;
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void printTable(const perf::MetricsSnapshot& snap) {
+    const perf::MetricsCounters& c = snap.counters;
+    printf("pid %u: frame %llu, %llu presented, %llu missed deadlines, %llu idle slots, %llu balls, updated %.1f ms ago\n",
+           snap.pid, (unsigned long long)c.frames, (unsigned long long)c.presented, (unsigned long long)c.missed,
+           (unsigned long long)c.skipped, (unsigned long long)c.balls, (nowNs() - snap.updateNs) / 1e6);
+    printf("%-12s %-4s %10s %10s %10s %10s %10s %10s %12s\n", "series", "unit", "min", "p50", "p95", "p99", "p99.9", "max", "samples");
+    for (const perf::MetricsSeries& series : snap.series) {
+        const perf::PerfStats& s = series.stats;
+        printf("%-12s %-4s %10u %10u %10u %10u %10u %10u %12llu\n", series.name.c_str(), series.unit.c_str(),
+               s.min, s.p50, s.p95, s.p99, s.p999, s.max, (unsigned long long)s.sampleCount);
+    }
+    fflush(stdout);
+}
+
+// cursors: per series, the sample count printed up to
+static void printJson(const perf::MetricsSnapshot& snap, bool samples, std::vector<uint64_t>& cursors) {
+    const perf::MetricsCounters& c = snap.counters;
+    printf("{\"pid\": %u, \"version\": %llu, \"update_ns\": %llu, \"frames\": %llu, \"presented\": %llu, \"missed\": %llu, \"skipped\": %llu, \"balls\": %llu, \"series\": [",
+           snap.pid, (unsigned long long)snap.version, (unsigned long long)snap.updateNs, (unsigned long long)c.frames,
+           (unsigned long long)c.presented, (unsigned long long)c.missed, (unsigned long long)c.skipped, (unsigned long long)c.balls);
+    for (size_t i = 0; i < snap.series.size(); ++i) {
+        const perf::MetricsSeries& series = snap.series[i];
+        const perf::PerfStats& s = series.stats;
+        printf("%s{\"name\": \"%s\", \"unit\": \"%s\", \"count\": %llu, \"min\": %u, \"p50\": %u, \"p95\": %u, \"p99\": %u, \"p999\": %u, \"max\": %u",
+               i ? ", " : "", series.name.c_str(), series.unit.c_str(), (unsigned long long)s.sampleCount, s.min, s.p50, s.p95, s.p99, s.p999, s.max);
+        if (samples) {
+            // the segment holds the newest METRICS_WINDOW samples, older ones are reported as dropped
+            uint64_t first = s.sampleCount - series.samples.size();
+            if (i >= cursors.size()) {
+                // the first line starts with what the segment holds
+                cursors.push_back(first);
+            }
+            uint64_t from = std::max(cursors[i], first);
+            printf(", \"dropped\": %llu, \"samples\": [", (unsigned long long)(from - cursors[i]));
+            for (uint64_t n = from; n < s.sampleCount; ++n) {
+                printf("%s%u", n > from ? ", " : "", series.samples[n - first]);
+            }
+            printf("]");
+            cursors[i] = s.sampleCount;
+        }
+        printf("}");
+    }
+    printf("]}\n");
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    const char* name = perf::METRICS_DEFAULT_NAME;
+    int intervalMs = 500;
+    long count = 0; // 0: until interrupted or the writer exits
+    bool json = false;
+    bool samples = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            intervalMs = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        }
+        else if (strcmp(argv[i], "--samples") == 0) {
+            json = true;
+            samples = true;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--name NAME] [--interval MS] [--count N] [--json] [--samples]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    perf::MetricsReader reader;
+    if (!reader.open(name)) {
+        return -1;
+    }
+    signal(SIGINT, [](int) { running = 0; });
+    signal(SIGTERM, [](int) { running = 0; });
+
+    perf::MetricsSnapshot snap;
+    std::vector<uint64_t> cursors;
+    for (long n = 0; running && (count == 0 || n < count); ++n) {
+        if (n > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+        }
+        if (!reader.read(snap)) {
+            fprintf(stderr, "The writer did not finish a publish, it may have died in one\n");
+            return -1;
+        }
+        if (json) {
+            printJson(snap, samples, cursors);
+        }
+        else {
+            printTable(snap);
+        }
+        // the writer unlinks the segment on exit, but a crashed one leaves it behind
+        if (kill((pid_t)snap.pid, 0) != 0 && errno == ESRCH) {
+            fprintf(stderr, "Writer %u has exited\n", snap.pid);
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace perf
+{
+    // Low-overhead span tracing, dumped as Chrome trace-event JSON (opens in Perfetto
+    // and chrome://tracing).
+    // Every thread records into its own fixed-size ring, so the hot path takes no lock
+    // and never allocates: a scope reads the clock twice and writes one slot. Rings
+    // are registered once per thread under a mutex and live until exit. When a ring
+    // wraps, the oldest spans are overwritten. A dump can run on any thread while the
+    // others keep recording; spans that were overwritten during the copy are dropped.
+    namespace trace
+    {
+        static constexpr size_t RING_SIZE = 1 << 14; // spans kept per thread
+
+        struct Ring
+        {
+            // atomics so a concurrent dump is not a data race; plain moves on x86
+            std::atomic<const char*> names[RING_SIZE];
+            std::atomic<uint64_t> begins[RING_SIZE];
+            std::atomic<uint64_t> ends[RING_SIZE];
+            std::atomic<uint64_t> written = 0;
+            std::atomic<const char*> threadName = nullptr;
+            uint32_t tid = 0;
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<Ring>> rings;
+            std::atomic<bool> enabled = false;
+            std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        };
+
+        inline Registry& registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        struct ThreadState
+        {
+            Ring* ring = nullptr; // made by the thread's first span
+            const char* name = nullptr;
+        };
+
+        inline ThreadState& threadState() {
+            thread_local ThreadState state;
+            return state;
+        }
+
+        inline Ring& threadRing() {
+            ThreadState& state = threadState();
+            if (!state.ring) {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.rings.push_back(std::make_unique<Ring>());
+                state.ring = reg.rings.back().get();
+                state.ring->tid = (uint32_t)reg.rings.size();
+                state.ring->threadName.store(state.name, std::memory_order_relaxed);
+            }
+            return *state.ring;
+        }
+
+        inline uint64_t nowNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count();
+        }
+
+        inline void setEnabled(bool enabled) { registry().enabled.store(enabled, std::memory_order_relaxed); }
+        inline bool isEnabled() { return registry().enabled.load(std::memory_order_relaxed); }
+
+        // shown as the track name; name must outlive the trace, string literals are fine.
+        // Kept with the thread until its first span, so naming a thread that never records
+        // (tracing off) does not allocate a ring for it.
+        inline void setThreadName(const char* name) {
+            ThreadState& state = threadState();
+            state.name = name;
+            if (state.ring) {
+                state.ring->threadName.store(name, std::memory_order_relaxed);
+            }
+        }
+
+        inline void record(const char* name, uint64_t beginNs, uint64_t endNs) {
+            Ring& ring = threadRing();
+            uint64_t n = ring.written.load(std::memory_order_relaxed);
+            size_t slot = n & (RING_SIZE - 1);
+            // release stores: a dump that sees this span also sees the count written before it
+            ring.names[slot].store(name, std::memory_order_release);
+            ring.begins[slot].store(beginNs, std::memory_order_release);
+            ring.ends[slot].store(endNs, std::memory_order_release);
+            ring.written.store(n + 1, std::memory_order_release);
+        }
+
+        // Writes all rings as {"traceEvents": [...]} to path. Returns the number of spans
+        // written or -1 if the file could not be written.
+        inline long writeChromeTrace(const char* path) {
+            FILE* file = fopen(path, "w");
+            if (!file) {
+                fprintf(stderr, "Failed to open trace file %s\n", path);
+                return -1;
+            }
+
+            Registry& reg = registry();
+            std::vector<Ring*> rings;
+            {
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                for (auto& ring : reg.rings) {
+                    rings.push_back(ring.get());
+                }
+            }
+
+            struct Span
+            {
+                const char* name;
+                uint64_t begin;
+                uint64_t end;
+            };
+            std::vector<Span> spans;
+            spans.reserve(RING_SIZE);
+
+            long count = 0;
+            bool first = true;
+            fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+            for (Ring* ring : rings) {
+                if (const char* threadName = ring->threadName.load(std::memory_order_relaxed)) {
+                    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                            first ? "" : ",\n", ring->tid, threadName);
+                    first = false;
+                }
+
+                // copy the newest RING_SIZE spans, then drop the ones the writer lapped meanwhile;
+                // span 'after' may be half written, so its slot counts as lapped too
+                uint64_t end = ring->written.load(std::memory_order_acquire);
+                uint64_t begin = end > RING_SIZE ? end - RING_SIZE : 0;
+                spans.clear();
+                for (uint64_t i = begin; i < end; ++i) {
+                    size_t slot = i & (RING_SIZE - 1);
+                    spans.push_back({ring->names[slot].load(std::memory_order_acquire),
+                                     ring->begins[slot].load(std::memory_order_acquire),
+                                     ring->ends[slot].load(std::memory_order_acquire)});
+                }
+                uint64_t after = ring->written.load(std::memory_order_relaxed);
+                size_t skip = after + 1 > begin + RING_SIZE ? (size_t)std::min<uint64_t>(after + 1 - begin - RING_SIZE, spans.size()) : 0;
+
+                for (size_t i = skip; i < spans.size(); ++i) {
+                    const Span& span = spans[i];
+                    fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                            first ? "" : ",\n", span.name, ring->tid, span.begin / 1000.0, (span.end - span.begin) / 1000.0);
+                    first = false;
+                    count++;
+                }
+            }
+            fprintf(file, "\n]}\n");
+
+            if (fclose(file) != 0) {
+                fprintf(stderr, "Failed to write trace file %s\n", path);
+                return -1;
+            }
+            return count;
+        }
+    }
+
+    // records the time between construction and destruction as one span
+    class TraceScope
+    {
+        public:
+            explicit TraceScope(const char* name) : mName(trace::isEnabled() ? name : nullptr) {
+                if (mName) {
+                    mBegin = trace::nowNs();
+                }
+            }
+
+            ~TraceScope() {
+                if (mName) {
+                    trace::record(mName, mBegin, trace::nowNs());
+                }
+            }
+
+            TraceScope(const TraceScope&) = delete;
+            TraceScope& operator=(const TraceScope&) = delete;
+
+        private:
+            const char* mName;
+            uint64_t mBegin = 0;
+    };
+}
+
+#define PERF_TRACE_CONCAT_INNER(a, b) a##b
+#define PERF_TRACE_CONCAT(a, b) PERF_TRACE_CONCAT_INNER(a, b)
+// traces the enclosing scope as a span called name (a string literal)
+#define TRACE_SCOPE(name) perf::TraceScope PERF_TRACE_CONCAT(traceScope, __LINE__)(name)
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace sim
+{
+    // Lock-free triple buffer for handing the newest state from one producer thread
+    // to one consumer thread. The producer fills back() and publish()es it; the
+    // consumer acquire()s the newest published slot. Slots are swapped with a single
+    // atomic exchange, so neither side ever waits for the other and the consumer
+    // simply keeps its current slot when nothing new has been published.
+    template<typename T>
+    class TripleBuffer
+    {
+        public:
+            // producer thread
+            T& back() { return mSlots[mBack]; }
+
+            void publish() {
+                mBack = mMiddle.exchange(mBack | DIRTY, std::memory_order_acq_rel) & INDEX_MASK;
+            }
+
+            // consumer thread
+            const T& acquire() {
+                if (mMiddle.load(std::memory_order_relaxed) & DIRTY) {
+                    mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & INDEX_MASK;
+                }
+                return mSlots[mFront];
+            }
+
+            // setup only, before the producer and consumer threads start
+            template<typename F>
+            void forEachSlot(F fn) {
+                for (auto& slot : mSlots) {
+                    fn(slot);
+                }
+            }
+
+        private:
+            static constexpr uint8_t DIRTY = 0x4;
+            static constexpr uint8_t INDEX_MASK = 0x3;
+
+            T mSlots[3];
+            uint8_t mBack = 0;
+            uint8_t mFront = 1;
+            std::atomic<uint8_t> mMiddle = 2;
+    };
+}